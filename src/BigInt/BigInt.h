@@ -36,6 +36,7 @@ struct BigInt {
     BigInt(const std::string& str) {
         initializeModValue(str);
     }
+    BigInt(const BigInt& n) = default;
     BigInt& operator=(const BigInt& n) {
         _montgomeryNumberData = n._montgomeryNumberData;
         isMontgomeryFormInitialized = n.isMontgomeryFormInitialized;
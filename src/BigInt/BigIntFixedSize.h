@@ -29,10 +29,7 @@ template<int Size=4> struct BigIntFixedSize {
     BigIntFixedSize(uint64_t value) { data[0] = value; bigIntKernels::clear<Size - 1>(ptr()+1); }
     BigIntFixedSize() : BigIntFixedSize(0) {}
     BigIntFixedSize(const std::string& str) { parseString(str); }
-    BigIntFixedSize(const BigIntGmp& other) {
-        debugAssert(Size >= other.sizeInBits());
-        bigIntKernels::copy(ptr(), other.ptr(), Size, other.sizeInBits());
-    }
+    BigIntFixedSize(const BigIntGmp& other); // defined in BigIntGmp.h
     template<int OtherSize> BigIntFixedSize(const BigIntFixedSize<OtherSize>& other) {
         bigIntKernels::copy<Size, OtherSize>(ptr(), other.ptr());
     }
@@ -341,7 +338,10 @@ template<int Size> void modInv(BigIntFixedSize<Size>& r, const BigIntFixedSize<S
     bigIntKernels::modInv<Size>(r.ptr(), a.ptr(), m.mod.ptr()); // TODO: is it ok? probably not
 }
 template<int Size> void modInv(BigIntFixedSize<Size>& r, const BigIntFixedSize<Size>& a, const MontgomeryReductionMod<BigIntFixedSize<Size>>& m) {
-    bigIntKernels::modInv<Size>(r.ptr(), a.ptr(), m.mod.ptr()); // TODO: is it ok? probably not
+    // (aR)^-1 = a^-1 * R^-1, so it has to be multiplied by R^2 to get Montgomery form of a^-1
+    bigIntKernels::modInv<Size>(r.ptr(), a.ptr(), m.mod.ptr());
+    convertToMontgomeryForm(r, r, m);
+    convertToMontgomeryForm(r, r, m);
 }
 template<int Size> void modPow(BigIntFixedSize<Size>& r, BigIntFixedSize<Size> a, BigIntFixedSize<Size> e, const MontgomeryReductionMod<BigIntFixedSize<Size>>& m) {
     r = getConstant(1, m);
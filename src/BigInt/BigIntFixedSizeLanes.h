@@ -0,0 +1,144 @@
+#pragma once
+#include "../Utility/debugAssert.h"
+#include "kernels.h"
+#include "common.h"
+#include "BigIntFixedSize.h"
+#include <array>
+#include <cstdint>
+
+/*
+    LaneCount independent numbers of up to 'Size' limbs, processed together so that every operation
+    is executed for all lanes at once with SIMD instructions (one number per lane).
+
+    Numbers are stored in 52-bit digits (see bigIntKernels lane kernels), which means that Montgomery form
+    of lanes uses R = 2^(52*DigitCount), not 2^(64*Size) like BigIntFixedSize.
+    Values have to be moved in and out with setLane/getLane, which work on plain (not Montgomery) values.
+*/
+template<int Size, int LaneCount> struct BigIntFixedSizeLanes {
+    static constexpr int DigitCount = (64 * Size + 52) / 52;
+
+    // data:
+    alignas(64) std::array<uint64_t, DigitCount * LaneCount> data;
+
+    // methods:
+    BigIntFixedSizeLanes() { data.fill(0); }
+
+    uint64_t* ptr()             { return &data[0]; }
+    const uint64_t* ptr() const { return &data[0]; }
+
+    uint64_t& digit(int digitIndex, int lane)             { return data[digitIndex * LaneCount + lane]; }
+    const uint64_t& digit(int digitIndex, int lane) const { return data[digitIndex * LaneCount + lane]; }
+};
+
+// true if lane arithmetic is faster than processing lanes one by one with BigIntFixedSize
+#ifdef AVX512_IFMA_IS_AVAILABLE
+constexpr bool BigIntLanesAreVectorized = true;
+#else
+constexpr bool BigIntLanesAreVectorized = false;
+#endif
+constexpr int BigIntLanesDefaultCount = 8;
+
+template<int Size, int LaneCount> void setLaneDigits(BigIntFixedSizeLanes<Size, LaneCount>& r, int lane, const BigIntFixedSize<Size>& a) {
+    for (int d = 0; d < r.DigitCount; ++d) {
+        int bitIndex = 52 * d;
+        int limb = bitIndex / 64;
+        int shift = bitIndex % 64;
+        uint64_t value = 0;
+        if (limb < Size) {
+            value = a[limb] >> shift;
+            if (shift > 12 && limb + 1 < Size) {
+                value |= a[limb + 1] << (64 - shift);
+            }
+        }
+        r.digit(d, lane) = value & bigIntKernels::LaneDigitMask;
+    }
+}
+template<int Size, int LaneCount> BigIntFixedSize<Size> getLaneDigits(const BigIntFixedSizeLanes<Size, LaneCount>& a, int lane) {
+    BigIntFixedSize<Size> r = 0;
+    for (int d = 0; d < a.DigitCount; ++d) {
+        int bitIndex = 52 * d;
+        int limb = bitIndex / 64;
+        int shift = bitIndex % 64;
+        if (limb < Size) {
+            r[limb] |= a.digit(d, lane) << shift;
+            if (shift > 12 && limb + 1 < Size) {
+                r[limb + 1] |= a.digit(d, lane) >> (64 - shift);
+            }
+        }
+    }
+    return r;
+}
+
+// every lane can have different modulus
+template<int Size, int LaneCount> MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>> getMontgomeryReductionMod(const std::array<BigIntFixedSize<Size>, LaneCount>& n) {
+    MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>> result;
+    for (int l = 0; l < LaneCount; ++l) {
+        debugAssert(n[l][0] % 2 == 1, "Montgomery reduction requires odd modulus");
+        setLaneDigits(result.mod, l, n[l]);
+        // -n^-1 mod 2^52 with Newton's iteration
+        uint64_t inverse = 1;
+        for (int i = 0; i < 6; ++i) {
+            inverse *= 2 - n[l][0] * inverse;
+        }
+        result.k.digit(0, l) = (0 - inverse) & bigIntKernels::LaneDigitMask;
+    }
+    result.b = 52 * BigIntFixedSizeLanes<Size, LaneCount>::DigitCount;
+    return result;
+}
+template<int Size, int LaneCount> MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>> getMontgomeryReductionMod(const BigIntFixedSize<Size>& n) {
+    std::array<BigIntFixedSize<Size>, LaneCount> lanes;
+    lanes.fill(n);
+    return getMontgomeryReductionMod<Size, LaneCount>(lanes);
+}
+
+// sets lane to Montgomery form of plain value a (a < lane modulus)
+template<int Size, int LaneCount> void setLane(BigIntFixedSizeLanes<Size, LaneCount>& r, int lane, const BigIntFixedSize<Size>& a, const MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>>& m) {
+    // a * 2^b by doubling, digits have enough spare bits so that nothing overflows
+    BigIntFixedSizeLanes<Size, LaneCount> value;
+    setLaneDigits(value, lane, a);
+    for (uint32_t i = 0; i < m.b; ++i) {
+        modDbl(value, value, m);
+    }
+    for (int d = 0; d < value.DigitCount; ++d) {
+        r.digit(d, lane) = value.digit(d, lane);
+    }
+}
+// returns plain value of lane in Montgomery form
+template<int Size, int LaneCount> BigIntFixedSize<Size> getLane(const BigIntFixedSizeLanes<Size, LaneCount>& a, int lane, const MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>>& m) {
+    BigIntFixedSizeLanes<Size, LaneCount> one;
+    for (int l = 0; l < LaneCount; ++l) {
+        one.digit(0, l) = 1;
+    }
+    BigIntFixedSizeLanes<Size, LaneCount> r;
+    modMul(r, a, one, m);
+    return getLaneDigits(r, lane);
+}
+
+template<int Size, int LaneCount> int sizeInLimbs(const MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>>& a) {
+    return Size;
+}
+template<int Size, int LaneCount> void swap(BigIntFixedSizeLanes<Size, LaneCount>& a, BigIntFixedSizeLanes<Size, LaneCount>& b) {
+    std::swap(a.data, b.data);
+}
+template<int Size, int LaneCount> void assign(BigIntFixedSizeLanes<Size, LaneCount>& r, const BigIntFixedSizeLanes<Size, LaneCount>& a) {
+    r = a;
+}
+template<int Size, int LaneCount> void modAdd(BigIntFixedSizeLanes<Size, LaneCount>& r, const BigIntFixedSizeLanes<Size, LaneCount>& a, const BigIntFixedSizeLanes<Size, LaneCount>& b, const MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>>& m) {
+    bigIntKernels::modAddLanes<BigIntFixedSizeLanes<Size, LaneCount>::DigitCount, LaneCount>(r.ptr(), a.ptr(), b.ptr(), m.mod.ptr());
+}
+template<int Size, int LaneCount> void modSub(BigIntFixedSizeLanes<Size, LaneCount>& r, const BigIntFixedSizeLanes<Size, LaneCount>& a, const BigIntFixedSizeLanes<Size, LaneCount>& b, const MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>>& m) {
+    bigIntKernels::modSubLanes<BigIntFixedSizeLanes<Size, LaneCount>::DigitCount, LaneCount>(r.ptr(), a.ptr(), b.ptr(), m.mod.ptr());
+}
+template<int Size, int LaneCount> void modMul(BigIntFixedSizeLanes<Size, LaneCount>& r, const BigIntFixedSizeLanes<Size, LaneCount>& a, const BigIntFixedSizeLanes<Size, LaneCount>& b, const MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>>& m) {
+    bigIntKernels::montgomeryMultLanes<BigIntFixedSizeLanes<Size, LaneCount>::DigitCount, LaneCount>(r.ptr(), a.ptr(), b.ptr(), m.k.ptr(), m.mod.ptr());
+}
+template<int Size, int LaneCount> void modSqr(BigIntFixedSizeLanes<Size, LaneCount>& r, const BigIntFixedSizeLanes<Size, LaneCount>& a, const MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>>& m) {
+    bigIntKernels::montgomerySqrLanes<BigIntFixedSizeLanes<Size, LaneCount>::DigitCount, LaneCount>(r.ptr(), a.ptr(), m.k.ptr(), m.mod.ptr());
+}
+template<int Size, int LaneCount> void modNeg(BigIntFixedSizeLanes<Size, LaneCount>& r, const BigIntFixedSizeLanes<Size, LaneCount>& a, const MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>>& m) {
+    BigIntFixedSizeLanes<Size, LaneCount> zero;
+    modSub(r, zero, a, m);
+}
+template<int Size, int LaneCount> void modDbl(BigIntFixedSizeLanes<Size, LaneCount>& r, const BigIntFixedSizeLanes<Size, LaneCount>& a, const MontgomeryReductionMod<BigIntFixedSizeLanes<Size, LaneCount>>& m) {
+    modAdd(r, a, a, m);
+}
@@ -20,6 +20,10 @@ struct BigIntGmp {
     template<int Size> BigIntGmp(const BigIntFixedSize<Size>& value) {
         mpz_init2(data, Size * 64);
         memcpy(ptr(), value.ptr(), Size * sizeof(uint64_t));
+        size() = Size;
+        while (size() > 0 && ptr()[size() - 1] == 0) {
+            size() -= 1;
+        }
     }
     BigIntGmp(const BigIntGmp& other) {
         mpz_init_set(data, other.data);
@@ -42,10 +46,8 @@ struct BigIntGmp {
         return *this;
     }
     BigIntGmp& operator=(BigIntGmp&& other) {
-        memcpy(&data[0], &other.data[0], sizeof(mpz_t));
-        other.data->_mp_alloc = 0;
-        other.data->_mp_size = 0;
-        other.data->_mp_d = nullptr;
+        // swap, so that memory of this value is freed by the other one
+        mpz_swap(data, other.data);
         return *this;
     }
     uint64_t operator[](int index) const {
@@ -77,6 +79,10 @@ struct BigIntGmp {
         return (s - 1) * 64 + static_cast<uint32_t>(::sizeInBits(ptr()[s - 1]));
     }
 };
+template<int Size> BigIntFixedSize<Size>::BigIntFixedSize(const BigIntGmp& other) {
+    debugAssert(Size >= other.size());
+    bigIntKernels::copy(ptr(), other.ptr(), Size, other.size());
+}
 template<> struct BigIntParseImpl<BigIntGmp> {
     static BigIntGmp parse(const std::string& str) {
         return BigIntGmp{ str };
@@ -415,7 +421,10 @@ void modDbl(BigIntGmp& r, const BigIntGmp& a, const MontgomeryReductionMod<BigIn
     modAdd(r, a, a, m);
 }
 void modInv(BigIntGmp& r, const BigIntGmp& a, const MontgomeryReductionMod<BigIntGmp>& m) {
+    // (aR)^-1 = a^-1 * R^-1, so it has to be multiplied by R^2 to get Montgomery form of a^-1
     modInv(r, a, m.mod);
+    convertToMontgomeryForm(r, r, m);
+    convertToMontgomeryForm(r, r, m);
 }
 void modPow(BigIntGmp& r, const BigIntGmp& a, const BigIntGmp& e, const BigIntGmp& m) {
     mpz_powm(r.data, a.data, e.data, m.data);
@@ -0,0 +1,72 @@
+#pragma once
+#include "../Utility/alwaysInline.h"
+#include "../Utility/debugAssert.h"
+#include "64bitIntrinsics.h"
+#include <cstdint>
+
+/*
+    Montgomery arithmetic modulo an odd n < 2^64 on plain uint64_t, with R = 2^64.
+    Values are kept in [0, n). Unlike MontgomeryReductionMod<BigIntFixedSize<1>> it has no
+    generic kernel dispatch, so the loops using it (rho, prime tests) compile to a few instructions per multiplication.
+*/
+struct Montgomery64 {
+    explicit Montgomery64(uint64_t n) : n(n) {
+        debugAssert(n % 2 == 1);
+        // Newton iteration doubles the number of correct low bits, n * n = 1 (mod 8) gives 3 of them
+        nInverse = n;
+        for (int i = 0; i < 5; ++i) {
+            nInverse *= 2 - n * nInverse;
+        }
+        one = (0 - n) % n;
+        r2 = one;
+        for (int i = 0; i < 64; ++i) {
+            r2 = add(r2, r2);
+        }
+    }
+
+    // (high * 2^64 + low) / 2^64 mod n, for high < n
+    ALWAYS_INLINE uint64_t reduce(uint64_t high, uint64_t low) const {
+        uint64_t m = low * nInverse;
+        uint64_t mnHigh, mnLow;
+        mul128(mnHigh, mnLow, m, n);
+        // low - mnLow is 0, so the result is high - mnHigh
+        uint64_t r = high - mnHigh;
+        return high < mnHigh ? r + n : r;
+    }
+    ALWAYS_INLINE uint64_t mul(uint64_t a, uint64_t b) const {
+        uint64_t high, low;
+        mul128(high, low, a, b);
+        return reduce(high, low);
+    }
+    ALWAYS_INLINE uint64_t sqr(uint64_t a) const {
+        return mul(a, a);
+    }
+    ALWAYS_INLINE uint64_t add(uint64_t a, uint64_t b) const {
+        return sub(a, n - b); // one comparison (compiles to cmov), a + b can overflow
+    }
+    ALWAYS_INLINE uint64_t sub(uint64_t a, uint64_t b) const {
+        uint64_t r = a - b;
+        return a < b ? r + n : r;
+    }
+    uint64_t toMontgomery(uint64_t a) const {
+        return mul(a % n, r2);
+    }
+    uint64_t fromMontgomery(uint64_t a) const {
+        return reduce(0, a);
+    }
+    uint64_t pow(uint64_t a, uint64_t e) const {
+        uint64_t r = one;
+        for (; e > 0; e >>= 1) {
+            if (e & 1) {
+                r = mul(r, a);
+            }
+            a = sqr(a);
+        }
+        return r;
+    }
+
+    uint64_t n;
+    uint64_t nInverse; // n^-1 mod 2^64
+    uint64_t one;      // 1 in Montgomery form (2^64 mod n)
+    uint64_t r2;       // 2^128 mod n, converts to Montgomery form
+};
@@ -0,0 +1,239 @@
+#pragma once
+#include "BigIntGmp.h"
+#include <gmp.h>
+#include <vector>
+#include <algorithm>
+
+/*
+    Polynomials with coefficients modulo n. Coefficient of X^i is at index i, all coefficients are in [0, n).
+
+    Multiplication uses Kronecker substitution: coefficients are packed into one big number with
+    enough zero bits between them so that coefficients of the product do not overlap, which turns polynomial
+    multiplication into a single mpn_mul (and GMP switches to FFT multiplication for big sizes).
+*/
+using PolynomialGmp = std::vector<BigIntGmp>;
+
+// r = a * b mod n, only first 'length' coefficients are computed (all if length < 0)
+void polyMul(PolynomialGmp& r, const PolynomialGmp& a, const PolynomialGmp& b, const BigIntGmp& n, int length = -1) {
+    int aSize = static_cast<int>(a.size());
+    int bSize = static_cast<int>(b.size());
+    if (length >= 0) {
+        aSize = std::min(aSize, length);
+        bSize = std::min(bSize, length);
+    }
+    if (aSize == 0 || bSize == 0) {
+        r.clear();
+        return;
+    }
+    int rSize = aSize + bSize - 1;
+    if (length >= 0) {
+        rSize = std::min(rSize, length);
+    }
+
+    // every coefficient of the product is a sum of at most min(aSize, bSize) values smaller than n^2
+    auto slotBits = 2 * bitSize(n) + static_cast<int>(sizeInBits(static_cast<uint64_t>(std::min(aSize, bSize)))) + 1;
+    auto slotLimbs = (slotBits + 63) / 64;
+    auto pack = [&](std::vector<mp_limb_t>& packed, const PolynomialGmp& p, int size) {
+        packed.assign(static_cast<std::size_t>(size) * slotLimbs, 0);
+        for (int i = 0; i < size; ++i) {
+            std::copy_n(p[i].ptr(), p[i].size(), packed.data() + static_cast<std::size_t>(i) * slotLimbs);
+        }
+    };
+    std::vector<mp_limb_t> aPacked, bPacked;
+    std::vector<mp_limb_t> product(static_cast<std::size_t>(aSize + bSize) * slotLimbs);
+    pack(aPacked, a, aSize);
+    if (&a == &b && aSize == bSize) {
+        mpn_sqr(product.data(), aPacked.data(), aPacked.size());
+    } else {
+        pack(bPacked, b, bSize);
+        if (aPacked.size() < bPacked.size()) {
+            std::swap(aPacked, bPacked);
+        }
+        mpn_mul(product.data(), aPacked.data(), aPacked.size(), bPacked.data(), bPacked.size());
+    }
+
+    PolynomialGmp result(rSize);
+    for (int i = 0; i < rSize; ++i) {
+        mpz_t slot;
+        mpz_roinit_n(slot, product.data() + static_cast<std::size_t>(i) * slotLimbs, slotLimbs);
+        mpz_mod(result[i].data, slot, n.data);
+    }
+    r = std::move(result);
+}
+
+// value = p(x) mod n
+void polyEvaluate(BigIntGmp& value, const PolynomialGmp& p, const BigIntGmp& x, const BigIntGmp& n) {
+    assign(value, 0);
+    for (auto i = p.size(); i-- > 0;) {
+        modMul(value, value, x, n);
+        modAdd(value, value, p[i], n);
+    }
+}
+
+// r = a^-1 mod X^length (with Newton's iteration r = r - r * (a * r - 1)), a[0] has to be 1
+void polyInverseSeries(PolynomialGmp& r, const PolynomialGmp& a, int length, const BigIntGmp& n) {
+    debugAssert(!a.empty() && a[0] == BigIntGmp{ 1 });
+    r.assign(1, BigIntGmp{ 1 });
+    PolynomialGmp error;
+    for (int precision = 1; precision < length;) {
+        precision = std::min(2 * precision, length);
+        polyMul(error, a, r, n, precision);
+        error.resize(precision);
+        // first coefficients of a * r are 1, 0, 0, ... so only the higher ones have to be corrected
+        std::fill(error.begin(), error.begin() + std::min<int>(r.size(), precision), BigIntGmp{ 0 });
+        polyMul(error, r, error, n, precision);
+        r.resize(precision);
+        for (int i = 0; i < static_cast<int>(error.size()); ++i) {
+            modSub(r[i], r[i], error[i], n);
+        }
+    }
+}
+
+// r = a mod b for monic b (r has deg(b) coefficients), where bReversedInverse = reverse(b)^-1 mod X^k for k > deg(a) - deg(b)
+void polyRem(PolynomialGmp& r, const PolynomialGmp& a, const PolynomialGmp& b, const PolynomialGmp& bReversedInverse, const BigIntGmp& n) {
+    int aSize = static_cast<int>(a.size());
+    int degree = static_cast<int>(b.size()) - 1;
+    if (aSize <= degree) {
+        r = a;
+        r.resize(degree);
+        return;
+    }
+    // reversed quotient is reverse(a) / reverse(b) mod X^quotientSize
+    int quotientSize = aSize - degree;
+    debugAssert(static_cast<int>(bReversedInverse.size()) >= quotientSize);
+    PolynomialGmp quotient(a.rbegin(), a.rbegin() + quotientSize);
+    polyMul(quotient, quotient, bReversedInverse, n, quotientSize);
+    quotient.resize(quotientSize);
+    std::reverse(quotient.begin(), quotient.end());
+
+    // only low deg(b) coefficients of a - quotient * b are non-zero
+    PolynomialGmp product;
+    polyMul(product, quotient, b, n, degree);
+    PolynomialGmp remainder(a.begin(), a.begin() + degree);
+    for (int i = 0; i < static_cast<int>(product.size()); ++i) {
+        modSub(remainder[i], remainder[i], product[i], n);
+    }
+    r = std::move(remainder);
+}
+// r = a mod b for monic b (r has deg(b) coefficients)
+void polyRem(PolynomialGmp& r, const PolynomialGmp& a, const PolynomialGmp& b, const BigIntGmp& n) {
+    int quotientSize = static_cast<int>(a.size()) - static_cast<int>(b.size()) + 1;
+    if (quotientSize <= 0) {
+        polyRem(r, a, b, PolynomialGmp{}, n);
+        return;
+    }
+    PolynomialGmp bReversed(b.rbegin(), b.rbegin() + std::min(quotientSize, static_cast<int>(b.size())));
+    PolynomialGmp bReversedInverse;
+    polyInverseSeries(bReversedInverse, bReversed, quotientSize, n);
+    polyRem(r, a, b, bReversedInverse, n);
+}
+
+// product of X - points[i]
+PolynomialGmp polyFromRoots(const std::vector<BigIntGmp>& points, const BigIntGmp& n) {
+    std::vector<PolynomialGmp> level;
+    for (auto& point : points) {
+        PolynomialGmp leaf(2, BigIntGmp{ 1 });
+        modNeg(leaf[0], point, n);
+        level.emplace_back(std::move(leaf));
+    }
+    while (level.size() > 1) {
+        for (std::size_t i = 0; i + 1 < level.size(); i += 2) {
+            polyMul(level[i / 2], level[i], level[i + 1], n);
+        }
+        if (level.size() % 2 == 1) {
+            swap(level[level.size() / 2], level.back());
+        }
+        level.resize((level.size() + 1) / 2);
+    }
+    return level.empty() ? PolynomialGmp{ BigIntGmp{ 1 } } : std::move(level[0]);
+}
+
+/*
+    Product tree of X - points[i], used for evaluation of many polynomials at the same points.
+    levels[0][i] = X - points[i], every node of levels[l + 1] is the product of two nodes of levels[l]
+    (last node of a level with odd number of nodes is moved up unchanged). Root is levels.back()[0].
+    Inverses for remainder tree are computed once: remainder of the parent has deg(parent) coefficients, so
+    inverses[l][i] = reverse(levels[l][i])^-1 mod X^(deg(parent) - deg(node) + 1), and inverse of the root
+    is enough for polynomials of degree up to maxDegree.
+*/
+struct PolynomialProductTree {
+    std::vector<BigIntGmp> points;
+    std::vector<std::vector<PolynomialGmp>> levels;
+    std::vector<std::vector<PolynomialGmp>> inverses;
+};
+PolynomialProductTree polyProductTree(const std::vector<BigIntGmp>& points, const BigIntGmp& n, int maxDegree = 0) {
+    PolynomialProductTree tree;
+    tree.points = points;
+    tree.levels.resize(1);
+    for (auto& point : points) {
+        PolynomialGmp leaf(2, BigIntGmp{ 1 });
+        modNeg(leaf[0], point, n);
+        tree.levels[0].emplace_back(std::move(leaf));
+    }
+    while (tree.levels.back().size() > 1) {
+        auto& level = tree.levels.back();
+        std::vector<PolynomialGmp> nextLevel((level.size() + 1) / 2);
+        for (std::size_t i = 0; i + 1 < level.size(); i += 2) {
+            polyMul(nextLevel[i / 2], level[i], level[i + 1], n);
+        }
+        if (level.size() % 2 == 1) {
+            nextLevel.back() = level.back();
+        }
+        tree.levels.emplace_back(std::move(nextLevel));
+    }
+    // leaves are evaluated directly, so they do not need inverses
+    tree.inverses.resize(tree.levels.size());
+    for (std::size_t l = 1; l + 1 < tree.levels.size(); ++l) {
+        auto& level = tree.levels[l];
+        tree.inverses[l].resize(level.size());
+        for (std::size_t i = 0; i < level.size(); ++i) {
+            if (i + 1 == level.size() && i % 2 == 0) {
+                continue;
+            }
+            auto& parent = tree.levels[l + 1][i / 2];
+            int precision = static_cast<int>(parent.size() - level[i].size()) + 1;
+            PolynomialGmp reversed(level[i].rbegin(), level[i].rbegin() + std::min(precision, static_cast<int>(level[i].size())));
+            polyInverseSeries(tree.inverses[l][i], reversed, precision, n);
+        }
+    }
+    auto& root = tree.levels.back()[0];
+    int rootPrecision = maxDegree - static_cast<int>(root.size()) + 2;
+    if (rootPrecision > 0) {
+        PolynomialGmp reversed(root.rbegin(), root.rbegin() + std::min(rootPrecision, static_cast<int>(root.size())));
+        polyInverseSeries(tree.inverses.back().emplace_back(), reversed, rootPrecision, n);
+    }
+    return tree;
+}
+
+// values[i] = p(tree.points[i]) mod n
+void polyMultipointEvaluate(std::vector<BigIntGmp>& values, const PolynomialGmp& p, const PolynomialProductTree& tree, const BigIntGmp& n) {
+    // remainder tree: remainder of a node is the remainder of its parent modulo the node
+    std::vector<PolynomialGmp> remainders(1);
+    auto& root = tree.levels.back()[0];
+    auto& rootInverses = tree.inverses.back();
+    if (!rootInverses.empty() && p.size() < root.size() + rootInverses[0].size()) {
+        polyRem(remainders[0], p, root, rootInverses[0], n);
+    } else {
+        polyRem(remainders[0], p, root, n);
+    }
+    for (auto level = tree.levels.size() - 1; level-- > 0;) {
+        auto& nodes = tree.levels[level];
+        std::vector<PolynomialGmp> childRemainders(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            auto& parentRemainder = remainders[i / 2];
+            if (i + 1 == nodes.size() && i % 2 == 0) {
+                childRemainders[i] = std::move(parentRemainder);
+            } else if (level == 0) {
+                childRemainders[i].resize(1);
+                polyEvaluate(childRemainders[i][0], parentRemainder, tree.points[i], n);
+            } else {
+                polyRem(childRemainders[i], parentRemainder, nodes[i], tree.inverses[level][i], n);
+            }
+        }
+        remainders = std::move(childRemainders);
+    }
+    values.resize(tree.points.size());
+    for (std::size_t i = 0; i < tree.points.size(); ++i) {
+        values[i] = remainders[i].empty() ? BigIntGmp{ 0 } : std::move(remainders[i][0]);
+    }
+}
@@ -2,7 +2,9 @@
 #include <cstdint>
 #include <string>
 #include <numeric>
+#include <utility>
 #include "common.h"
+#include "../Utility/bitManipulation.h"
 
 template<> struct BigIntParseImpl<uint64_t> {
     static uint64_t parse(const std::string& str) {
@@ -101,8 +103,24 @@ void modInv(int64_t& t, int64_t a, int64_t m) {
         t += m;
     }
 }
+// Stein's algorithm: only shifts and subtractions, no divisions
+uint64_t binaryGcd(uint64_t a, uint64_t b) {
+    if (a == 0 || b == 0) {
+        return a | b;
+    }
+    auto shift = trailingZeroBitCount(a | b);
+    a >>= trailingZeroBitCount(a);
+    while (b != 0) {
+        b >>= trailingZeroBitCount(b);
+        if (a > b) {
+            std::swap(a, b);
+        }
+        b -= a;
+    }
+    return a << shift;
+}
 void gcd(uint64_t& r, const uint64_t& a, const uint64_t& b) {
-    r = std::gcd(a, b);
+    r = binaryGcd(a, b);
 }
 void pow2Mod(uint64_t& r, uint64_t e, uint64_t mod) {
     r = 1;
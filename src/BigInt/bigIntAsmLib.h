@@ -1,4 +1,6 @@
 #pragma once
+#include "../Utility/compilerMacros.h"
+#include "../Utility/cpuFeatures.h"
 #include <stdint.h>
 
 #ifdef USE_ASM_LIB
@@ -18,4 +20,219 @@ extern "C" void montgomerySqr5(uint64_t* r, const uint64_t* A, const uint64_t* k
 extern "C" void montgomerySqr6(uint64_t* r, const uint64_t* A, const uint64_t* k, const uint64_t* m, uint32_t b);
 extern "C" void montgomerySqr7(uint64_t* r, const uint64_t* A, const uint64_t* k, const uint64_t* m, uint32_t b);
 extern "C" void montgomerySqr8(uint64_t* r, const uint64_t* A, const uint64_t* k, const uint64_t* m, uint32_t b);
+#elif (defined(COMPILER_GCC) || defined(COMPILER_CLANG)) && defined(__x86_64__)
+#define MULX_ASM_IS_AVAILABLE
+
+/*
+    Montgomery multiplication (CIOS) in inline assembly for GCC/Clang, used instead of bigIntAsmlib.lib outside of Windows.
+    Requires BMI2 (MULX) and ADX (ADCX/ADOX), so it is only used if mulxAsmIsSupported().
+
+    Accumulator t has S+2 limbs in registers. Every row adds A*B[i] and then q*m (q = t[0] * k[0]), which makes t[0] zero,
+    so instead of shifting, the next row uses the registers rotated by one. Products are added with two independent
+    carry chains: low halves with ADCX (carry flag) and high halves with ADOX (overflow flag).
+    Result is smaller than 2m, so it still has to be reduced once (returned value is its limb number S).
+*/
+bool mulxAsmIsSupported() {
+    return CurrentCpuFeatures.bmi2 && CurrentCpuFeatures.adx;
+}
+
+#define MULX_STEP(ptr, offset, tj, tj1)                      \
+    "mulxq " offset "(%[" ptr "]), %[lo], %[hi]\n\t"         \
+    "adcxq %[lo], %[" tj "]\n\t"                             \
+    "adoxq %[hi], %[" tj1 "]\n\t"
+#define MULX_CHAIN_BEGIN                                      \
+    "xorl %k[lo], %k[lo]\n\t"
+#define MULX_CHAIN_END(tS, tS1)                               \
+    "adcxq %[zero], %[" tS "]\n\t"                           \
+    "adoxq %[zero], %[" tS1 "]\n\t"                          \
+    "adcxq %[zero], %[" tS1 "]\n\t"
+#define MULX_LOAD_MULTIPLIER(b)                               \
+    "movq %[" b "], %%rdx\n\t"
+#define MULX_LOAD_REDUCTION_FACTOR(t0)                        \
+    "movq %[" t0 "], %%rdx\n\t"                              \
+    "imulq %[k0], %%rdx\n\t"
+
+#define MONTGOMERY_MULX_ROW_2(b, t0, t1, t2, t3) \
+    MULX_LOAD_MULTIPLIER(b) MULX_CHAIN_BEGIN \
+    MULX_STEP("a", "0", t0, t1) \
+    MULX_STEP("a", "8", t1, t2) \
+    MULX_CHAIN_END(t2, t3) \
+    MULX_LOAD_REDUCTION_FACTOR(t0) MULX_CHAIN_BEGIN \
+    MULX_STEP("m", "0", t0, t1) \
+    MULX_STEP("m", "8", t1, t2) \
+    MULX_CHAIN_END(t2, t3)
+#define MONTGOMERY_MULX_ROW_3(b, t0, t1, t2, t3, t4) \
+    MULX_LOAD_MULTIPLIER(b) MULX_CHAIN_BEGIN \
+    MULX_STEP("a", "0", t0, t1) \
+    MULX_STEP("a", "8", t1, t2) \
+    MULX_STEP("a", "16", t2, t3) \
+    MULX_CHAIN_END(t3, t4) \
+    MULX_LOAD_REDUCTION_FACTOR(t0) MULX_CHAIN_BEGIN \
+    MULX_STEP("m", "0", t0, t1) \
+    MULX_STEP("m", "8", t1, t2) \
+    MULX_STEP("m", "16", t2, t3) \
+    MULX_CHAIN_END(t3, t4)
+#define MONTGOMERY_MULX_ROW_4(b, t0, t1, t2, t3, t4, t5) \
+    MULX_LOAD_MULTIPLIER(b) MULX_CHAIN_BEGIN \
+    MULX_STEP("a", "0", t0, t1) \
+    MULX_STEP("a", "8", t1, t2) \
+    MULX_STEP("a", "16", t2, t3) \
+    MULX_STEP("a", "24", t3, t4) \
+    MULX_CHAIN_END(t4, t5) \
+    MULX_LOAD_REDUCTION_FACTOR(t0) MULX_CHAIN_BEGIN \
+    MULX_STEP("m", "0", t0, t1) \
+    MULX_STEP("m", "8", t1, t2) \
+    MULX_STEP("m", "16", t2, t3) \
+    MULX_STEP("m", "24", t3, t4) \
+    MULX_CHAIN_END(t4, t5)
+#define MONTGOMERY_MULX_ROW_5(b, t0, t1, t2, t3, t4, t5, t6) \
+    MULX_LOAD_MULTIPLIER(b) MULX_CHAIN_BEGIN \
+    MULX_STEP("a", "0", t0, t1) \
+    MULX_STEP("a", "8", t1, t2) \
+    MULX_STEP("a", "16", t2, t3) \
+    MULX_STEP("a", "24", t3, t4) \
+    MULX_STEP("a", "32", t4, t5) \
+    MULX_CHAIN_END(t5, t6) \
+    MULX_LOAD_REDUCTION_FACTOR(t0) MULX_CHAIN_BEGIN \
+    MULX_STEP("m", "0", t0, t1) \
+    MULX_STEP("m", "8", t1, t2) \
+    MULX_STEP("m", "16", t2, t3) \
+    MULX_STEP("m", "24", t3, t4) \
+    MULX_STEP("m", "32", t4, t5) \
+    MULX_CHAIN_END(t5, t6)
+#define MONTGOMERY_MULX_ROW_6(b, t0, t1, t2, t3, t4, t5, t6, t7) \
+    MULX_LOAD_MULTIPLIER(b) MULX_CHAIN_BEGIN \
+    MULX_STEP("a", "0", t0, t1) \
+    MULX_STEP("a", "8", t1, t2) \
+    MULX_STEP("a", "16", t2, t3) \
+    MULX_STEP("a", "24", t3, t4) \
+    MULX_STEP("a", "32", t4, t5) \
+    MULX_STEP("a", "40", t5, t6) \
+    MULX_CHAIN_END(t6, t7) \
+    MULX_LOAD_REDUCTION_FACTOR(t0) MULX_CHAIN_BEGIN \
+    MULX_STEP("m", "0", t0, t1) \
+    MULX_STEP("m", "8", t1, t2) \
+    MULX_STEP("m", "16", t2, t3) \
+    MULX_STEP("m", "24", t3, t4) \
+    MULX_STEP("m", "32", t4, t5) \
+    MULX_STEP("m", "40", t5, t6) \
+    MULX_CHAIN_END(t6, t7)
+
+template<int S> uint64_t montgomeryMultMulx(uint64_t* r, const uint64_t* A, const uint64_t* B, uint64_t k0, const uint64_t* m);
+template<> uint64_t montgomeryMultMulx<2>(uint64_t* r, const uint64_t* A, const uint64_t* B, uint64_t k0, const uint64_t* m) {
+    uint64_t t[4] = {};
+    uint64_t b[2] = { B[0], B[1] };
+    uint64_t lo, hi, rdx;
+    const uint64_t zero = 0;
+    __asm__(
+        MONTGOMERY_MULX_ROW_2("b0", "t0", "t1", "t2", "t3")
+        MONTGOMERY_MULX_ROW_2("b1", "t1", "t2", "t3", "t0")
+        : [t0] "+&r"(t[0]), [t1] "+&r"(t[1]), [t2] "+&r"(t[2]), [t3] "+&r"(t[3]),
+          [lo] "=&r"(lo), [hi] "=&r"(hi), "=&d"(rdx)
+        : [a] "r"(A), [m] "r"(m), [k0] "m"(k0), [zero] "m"(zero), [b0] "m"(b[0]), [b1] "m"(b[1])
+        : "cc", "memory"
+    );
+    r[0] = t[2];
+    r[1] = t[3];
+    return t[0];
+}
+template<> uint64_t montgomeryMultMulx<3>(uint64_t* r, const uint64_t* A, const uint64_t* B, uint64_t k0, const uint64_t* m) {
+    uint64_t t[5] = {};
+    uint64_t b[3] = { B[0], B[1], B[2] };
+    uint64_t lo, hi, rdx;
+    const uint64_t zero = 0;
+    __asm__(
+        MONTGOMERY_MULX_ROW_3("b0", "t0", "t1", "t2", "t3", "t4")
+        MONTGOMERY_MULX_ROW_3("b1", "t1", "t2", "t3", "t4", "t0")
+        MONTGOMERY_MULX_ROW_3("b2", "t2", "t3", "t4", "t0", "t1")
+        : [t0] "+&r"(t[0]), [t1] "+&r"(t[1]), [t2] "+&r"(t[2]), [t3] "+&r"(t[3]), [t4] "+&r"(t[4]),
+          [lo] "=&r"(lo), [hi] "=&r"(hi), "=&d"(rdx)
+        : [a] "r"(A), [m] "r"(m), [k0] "m"(k0), [zero] "m"(zero), [b0] "m"(b[0]), [b1] "m"(b[1]), [b2] "m"(b[2])
+        : "cc", "memory"
+    );
+    r[0] = t[3];
+    r[1] = t[4];
+    r[2] = t[0];
+    return t[1];
+}
+template<> uint64_t montgomeryMultMulx<4>(uint64_t* r, const uint64_t* A, const uint64_t* B, uint64_t k0, const uint64_t* m) {
+    uint64_t t[6] = {};
+    uint64_t b[4] = { B[0], B[1], B[2], B[3] };
+    uint64_t lo, hi, rdx;
+    const uint64_t zero = 0;
+    __asm__(
+        MONTGOMERY_MULX_ROW_4("b0", "t0", "t1", "t2", "t3", "t4", "t5")
+        MONTGOMERY_MULX_ROW_4("b1", "t1", "t2", "t3", "t4", "t5", "t0")
+        MONTGOMERY_MULX_ROW_4("b2", "t2", "t3", "t4", "t5", "t0", "t1")
+        MONTGOMERY_MULX_ROW_4("b3", "t3", "t4", "t5", "t0", "t1", "t2")
+        : [t0] "+&r"(t[0]), [t1] "+&r"(t[1]), [t2] "+&r"(t[2]), [t3] "+&r"(t[3]), [t4] "+&r"(t[4]), [t5] "+&r"(t[5]),
+          [lo] "=&r"(lo), [hi] "=&r"(hi), "=&d"(rdx)
+        : [a] "r"(A), [m] "r"(m), [k0] "m"(k0), [zero] "m"(zero), [b0] "m"(b[0]), [b1] "m"(b[1]), [b2] "m"(b[2]), [b3] "m"(b[3])
+        : "cc", "memory"
+    );
+    r[0] = t[4];
+    r[1] = t[5];
+    r[2] = t[0];
+    r[3] = t[1];
+    return t[2];
+}
+template<> uint64_t montgomeryMultMulx<5>(uint64_t* r, const uint64_t* A, const uint64_t* B, uint64_t k0, const uint64_t* m) {
+    uint64_t t[7] = {};
+    uint64_t b[5] = { B[0], B[1], B[2], B[3], B[4] };
+    uint64_t lo, hi, rdx;
+    const uint64_t zero = 0;
+    __asm__(
+        MONTGOMERY_MULX_ROW_5("b0", "t0", "t1", "t2", "t3", "t4", "t5", "t6")
+        MONTGOMERY_MULX_ROW_5("b1", "t1", "t2", "t3", "t4", "t5", "t6", "t0")
+        MONTGOMERY_MULX_ROW_5("b2", "t2", "t3", "t4", "t5", "t6", "t0", "t1")
+        MONTGOMERY_MULX_ROW_5("b3", "t3", "t4", "t5", "t6", "t0", "t1", "t2")
+        MONTGOMERY_MULX_ROW_5("b4", "t4", "t5", "t6", "t0", "t1", "t2", "t3")
+        : [t0] "+&r"(t[0]), [t1] "+&r"(t[1]), [t2] "+&r"(t[2]), [t3] "+&r"(t[3]), [t4] "+&r"(t[4]), [t5] "+&r"(t[5]), [t6] "+&r"(t[6]),
+          [lo] "=&r"(lo), [hi] "=&r"(hi), "=&d"(rdx)
+        : [a] "r"(A), [m] "r"(m), [k0] "m"(k0), [zero] "m"(zero), [b0] "m"(b[0]), [b1] "m"(b[1]), [b2] "m"(b[2]), [b3] "m"(b[3]), [b4] "m"(b[4])
+        : "cc", "memory"
+    );
+    r[0] = t[5];
+    r[1] = t[6];
+    r[2] = t[0];
+    r[3] = t[1];
+    r[4] = t[2];
+    return t[3];
+}
+template<> uint64_t montgomeryMultMulx<6>(uint64_t* r, const uint64_t* A, const uint64_t* B, uint64_t k0, const uint64_t* m) {
+    uint64_t t[8] = {};
+    uint64_t b[6] = { B[0], B[1], B[2], B[3], B[4], B[5] };
+    uint64_t lo, hi, rdx;
+    const uint64_t zero = 0;
+    __asm__(
+        MONTGOMERY_MULX_ROW_6("b0", "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7")
+        MONTGOMERY_MULX_ROW_6("b1", "t1", "t2", "t3", "t4", "t5", "t6", "t7", "t0")
+        MONTGOMERY_MULX_ROW_6("b2", "t2", "t3", "t4", "t5", "t6", "t7", "t0", "t1")
+        MONTGOMERY_MULX_ROW_6("b3", "t3", "t4", "t5", "t6", "t7", "t0", "t1", "t2")
+        MONTGOMERY_MULX_ROW_6("b4", "t4", "t5", "t6", "t7", "t0", "t1", "t2", "t3")
+        MONTGOMERY_MULX_ROW_6("b5", "t5", "t6", "t7", "t0", "t1", "t2", "t3", "t4")
+        : [t0] "+&r"(t[0]), [t1] "+&r"(t[1]), [t2] "+&r"(t[2]), [t3] "+&r"(t[3]), [t4] "+&r"(t[4]), [t5] "+&r"(t[5]), [t6] "+&r"(t[6]), [t7] "+&r"(t[7]),
+          [lo] "=&r"(lo), [hi] "=&r"(hi), "=&d"(rdx)
+        : [a] "r"(A), [m] "r"(m), [k0] "m"(k0), [zero] "m"(zero), [b0] "m"(b[0]), [b1] "m"(b[1]), [b2] "m"(b[2]), [b3] "m"(b[3]), [b4] "m"(b[4]), [b5] "m"(b[5])
+        : "cc", "memory"
+    );
+    r[0] = t[6];
+    r[1] = t[7];
+    r[2] = t[0];
+    r[3] = t[1];
+    r[4] = t[2];
+    r[5] = t[3];
+    return t[4];
+}
+
+#undef MULX_STEP
+#undef MULX_CHAIN_BEGIN
+#undef MULX_CHAIN_END
+#undef MULX_LOAD_MULTIPLIER
+#undef MULX_LOAD_REDUCTION_FACTOR
+#undef MONTGOMERY_MULX_ROW_2
+#undef MONTGOMERY_MULX_ROW_3
+#undef MONTGOMERY_MULX_ROW_4
+#undef MONTGOMERY_MULX_ROW_5
+#undef MONTGOMERY_MULX_ROW_6
 #endif
@@ -1,6 +1,8 @@
 
 #include "BigIntGmp.h"
+#include "PolynomialGmp.h"
 #include "BigIntFixedSize.h"
+#include "BigIntFixedSizeLanes.h"
 #include "BigIntMaxCap.h"
 #include "Unsigned64.h"
 #include "BigInt.h"
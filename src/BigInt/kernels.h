@@ -9,8 +9,16 @@
 #include "bigIntAsmLib.h"
 #include <cstdint>
 #include <cstring>
+#include <array>
+#include <algorithm>
+#include <utility>
 #include <gmp.h>
 
+#ifdef __AVX512IFMA__
+    #define AVX512_IFMA_IS_AVAILABLE
+    #include <immintrin.h>
+#endif
+
 namespace bigIntKernels {
     using Limb     = uint64_t;
     using Int      = Limb*;
@@ -550,11 +558,10 @@ namespace bigIntKernels {
 
     template<int SR, int SA, int SB, int SRem> void div(Int r, ConstInt a, ConstInt b, Int rem) {
         static_assert(SR >= SA - SB, "the division result might not fit in a given buffer");
-        Limb aa[SA + 2];
+        Limb aa[SA + SB + 1]; // quotient limbs are subtracted over SB + 1 limbs, even if b is shorter
         Limb bb[SB];
         Limb tmp[SB + 1];
-        aa[SA + 1] = 0;
-        aa[SA] = 0;
+        clear<SB + 1>(aa + SA);
 
         auto realSizeB = sizeInBits<SB>(b);
         auto shiftSize = (64 - realSizeB % 64) % 64;
@@ -567,7 +574,8 @@ namespace bigIntKernels {
 
         clear<SR>(r);
         for (int i = realLimbSizeA - realLimbSizeB; i >= 0; --i) {
-            auto d = div128(aa[i + realLimbSizeB], aa[i + realLimbSizeB - 1], bb[realLimbSizeB - 1]);
+            // the remainder is below b, so the top limbs can only be equal, then the quotient limb is at most 2^64 - 1
+            auto d = aa[i + realLimbSizeB] >= bb[realLimbSizeB - 1] ? ~Limb(0) : div128(aa[i + realLimbSizeB], aa[i + realLimbSizeB - 1], bb[realLimbSizeB - 1]);
             mulLimb(tmp, bb, d, SB);
             if (sub<SB + 1>(&aa[i], &aa[i], tmp)) {
                 d -= 1;
@@ -582,11 +590,10 @@ namespace bigIntKernels {
         copy<SRem>(rem, aa);
     }
     template<int Capacity> void div(Int r, ConstInt a, ConstInt b, Int rem, int32_t sa, int32_t sb, int32_t srem) {
-        Limb aa[Capacity + 2];
+        Limb aa[2 * Capacity + 1];
         Limb bb[Capacity];
         Limb tmp[Capacity + 1];
-        aa[sa + 1] = 0;
-        aa[sa] = 0;
+        clear(aa + sa, sb + 1);
 
         auto realSizeB = 64*(sb-1) + ::sizeInBits(b[sb-1]);
         auto shiftSize = (64 - realSizeB % 64) % 64;
@@ -599,7 +606,7 @@ namespace bigIntKernels {
 
         clear(r, sa-sb+1);
         for (int i = realLimbSizeA - realLimbSizeB; i >= 0; --i) {
-            auto d = div128(aa[i + realLimbSizeB], aa[i + realLimbSizeB - 1], bb[realLimbSizeB - 1]);
+            auto d = aa[i + realLimbSizeB] >= bb[realLimbSizeB - 1] ? ~Limb(0) : div128(aa[i + realLimbSizeB], aa[i + realLimbSizeB - 1], bb[realLimbSizeB - 1]);
             mulLimb(tmp, bb, d, sb);
             if (sub(&aa[i], &aa[i], tmp, sb+1, sb+1)) {
                 d -= 1;
@@ -655,7 +662,7 @@ namespace bigIntKernels {
         x -= c0 * y;
         return g;
     }
-    template<int S> void modInv(Int r, ConstInt a, ConstInt m) {
+    template<int S> void modInvGmp(Int r, ConstInt a, ConstInt m) {
         Limb aCopy[S];
         Limb mCopy[S];
         Limb g[S];
@@ -696,7 +703,7 @@ namespace bigIntKernels {
     }
 
     // r = gcd(a, b)
-    template<int S> void gcd(Int r, ConstInt a, ConstInt b) {
+    template<int S> void gcdGmp(Int r, ConstInt a, ConstInt b) {
         Limb aCopy[S];
         Limb bCopy[S];
         copy<S>(aCopy, a);
@@ -705,6 +712,263 @@ namespace bigIntKernels {
         mpn_gcd(r, aCopy, realSize<S>(a), bCopy, realSize<S>(b));
     }
 
+    /*
+        GCD and modular inverse of fixed-size numbers with Pornin's optimized binary GCD, without copying them to GMP.
+        Binary GCD step (b is odd): if a is odd { if a < b swap(a, b); a -= b; } a /= 2.
+        BinaryGcdInnerSteps of them are done on 64-bit approximations of a and b (their low 30 bits and the top 34 bits
+        of the longer one), which tracks them in a matrix of small signed factors (f0, g0; f1, g1). The matrix is then
+        applied to the whole numbers: a' = (a*f0 + b*g0) / 2^30, b' = (a*f1 + b*g1) / 2^30, so every 30 steps cost
+        only two linear combinations over the current length of a and b. Wrong decisions caused by the approximations
+        only make a' or b' negative, which is fixed by negating them together with their factors.
+        For the inverse of y mod m, a = y and b = m, and u, v with a = u*y, b = v*y (mod m) get the same matrices,
+        two of them at once (their product has factors up to 2^60), divided by 2^60 modulo m like in Montgomery reduction.
+        The factors are at most 2^30 in absolute value, so f + g*2^32 is kept in one register.
+        GCD finishes with ordinary binary GCD once a and b fit in one limb.
+    */
+    constexpr int BinaryGcdInnerSteps = 30;
+
+    template<int S> bool isZero(ConstInt a) {
+        for (int i = 0; i < S; ++i) {
+            if (a[i] != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+    template<int S> uint32_t trailingZeroBitCount(ConstInt a) {
+        for (int i = 0; i < S; ++i) {
+            if (a[i] != 0) {
+                return 64 * i + static_cast<uint32_t>(::trailingZeroBitCount(a[i]));
+            }
+        }
+        return 64 * S;
+    }
+    // low 30 bits of a and its bits [bits - 34, bits), exact if bits <= 64
+    template<int S> ALWAYS_INLINE Limb binaryGcdApproximation(ConstInt a, int32_t bits) {
+        if (bits <= 64) {
+            return a[0];
+        }
+        auto position = bits - (64 - BinaryGcdInnerSteps);
+        auto limb = position / 64;
+        auto shift = position % 64;
+        Limb top = a[limb] >> shift;
+        if (shift > BinaryGcdInnerSteps && limb + 1 < S) {
+            top |= a[limb + 1] << (64 - shift);
+        }
+        constexpr Limb LowMask = (1ull << BinaryGcdInnerSteps) - 1;
+        return (top << BinaryGcdInnerSteps) | (a[0] & LowMask);
+    }
+    // BinaryGcdInnerSteps steps on approximations a and b (b odd)
+    ALWAYS_INLINE void binaryGcdInnerSteps(Limb a, Limb b, int64_t& f0, int64_t& g0, int64_t& f1, int64_t& g1) {
+        // f + g*2^32 (mod 2^64) of both rows, linear steps work on both halves at once
+        Limb p0 = 1;
+        Limb p1 = 1ull << 32;
+        // all divisions by 2 in a row are done at once, every one of them is a step
+        int32_t steps = BinaryGcdInnerSteps;
+        while (true) {
+            auto zeros = ::trailingZeroBitCount(a | (1ull << steps));
+            a >>= zeros;
+            p1 <<= zeros;
+            steps -= zeros;
+            if (steps == 0) {
+                break;
+            }
+            // a is odd, masks instead of conditions, the branches would be mispredicted half of the time
+            Limb d = a - b;
+            Limb pd = p0 - p1;
+            Limb swapMask = 0 - static_cast<Limb>(a < b);
+            b += d & swapMask;
+            p1 += pd & swapMask;
+            a = (d ^ swapMask) - swapMask;
+            p0 = (pd ^ swapMask) - swapMask;
+        }
+        f0 = static_cast<int32_t>(p0);
+        g0 = (static_cast<int64_t>(p0) - f0) >> 32;
+        f1 = static_cast<int32_t>(p1);
+        g1 = (static_cast<int64_t>(p1) - f1) >> 32;
+    }
+    // r (s + 1 limbs) = |a*f + b*g| for s-limb a and b, returns true if a*f + b*g < 0 (|f|, |g| <= 2^30)
+    ALWAYS_INLINE bool binaryGcdLinearCombination(Int r, ConstInt a, int64_t f, ConstInt b, int64_t g, int32_t s) {
+        // two's complement: a[i]*f = a[i]*(f mod 2^64) - (f < 0 ? a[i]*2^64 : 0), one unsigned multiplication
+        Limb aMask = 0 - static_cast<Limb>(f < 0);
+        Limb bMask = 0 - static_cast<Limb>(g < 0);
+        __uint128_t sum = 0;
+        for (int i = 0; i < s; ++i) {
+            sum += static_cast<__uint128_t>(a[i]) * static_cast<Limb>(f) - (static_cast<__uint128_t>(a[i] & aMask) << 64);
+            sum += static_cast<__uint128_t>(b[i]) * static_cast<Limb>(g) - (static_cast<__uint128_t>(b[i] & bMask) << 64);
+            r[i] = static_cast<Limb>(sum);
+            sum = static_cast<__uint128_t>(static_cast<__int128_t>(sum) >> 64);
+        }
+        r[s] = static_cast<Limb>(sum);
+        // branchless negation, the sign is unpredictable
+        Limb signMask = 0 - (r[s] >> 63);
+        uint8_t carry = static_cast<uint8_t>(signMask & 1);
+        for (int i = 0; i <= s; ++i) {
+            carry = addCarry(carry, r[i], r[i] ^ signMask, 0);
+        }
+        return signMask != 0;
+    }
+    // a, b = (a*f0 + b*g0) / 2^30, (a*f1 + b*g1) / 2^30, factors of negative results are negated with them
+    // (only the low s limbs of a and b are not zero, and that stays so)
+    template<int S> ALWAYS_INLINE void binaryGcdUpdate(Int a, Int b, int64_t& f0, int64_t& g0, int64_t& f1, int64_t& g1, int32_t s) {
+        Limb x[S + 1];
+        Limb y[S + 1];
+        if (binaryGcdLinearCombination(x, a, f0, b, g0, s)) {
+            f0 = -f0;
+            g0 = -g0;
+        }
+        if (binaryGcdLinearCombination(y, a, f1, b, g1, s)) {
+            f1 = -f1;
+            g1 = -g1;
+        }
+        for (int i = 0; i < s; ++i) {
+            a[i] = (x[i] >> BinaryGcdInnerSteps) | (x[i + 1] << (64 - BinaryGcdInnerSteps));
+            b[i] = (y[i] >> BinaryGcdInnerSteps) | (y[i + 1] << (64 - BinaryGcdInnerSteps));
+        }
+    }
+    // r = (u*f + v*g) / 2^Shift mod m, for u, v < m, |f| + |g| <= 2^Shift <= 2^60, mInverse = -m^-1 mod 2^64
+    template<int S, int Shift> ALWAYS_INLINE void binaryGcdCoefficient(Int r, ConstInt u, int64_t f, ConstInt v, int64_t g, ConstInt m, Limb mInverse) {
+        constexpr Limb LowMask = (1ull << Shift) - 1;
+        // adding q*m clears the low Shift bits (like in Montgomery reduction), -2^Shift*m < u*f + v*g + q*m < 2^(Shift+1)*m
+        Limb q = ((u[0] * static_cast<Limb>(f) + v[0] * static_cast<Limb>(g)) * mInverse) & LowMask;
+        Limb uMask = 0 - static_cast<Limb>(f < 0);
+        Limb vMask = 0 - static_cast<Limb>(g < 0);
+        Limb t[S + 1];
+        __uint128_t sum = 0;
+        for (int i = 0; i < S; ++i) {
+            sum += static_cast<__uint128_t>(u[i]) * static_cast<Limb>(f) - (static_cast<__uint128_t>(u[i] & uMask) << 64);
+            sum += static_cast<__uint128_t>(v[i]) * static_cast<Limb>(g) - (static_cast<__uint128_t>(v[i] & vMask) << 64);
+            sum += static_cast<__uint128_t>(m[i]) * q;
+            t[i] = static_cast<Limb>(sum);
+            sum = static_cast<__uint128_t>(static_cast<__int128_t>(sum) >> 64);
+        }
+        t[S] = static_cast<Limb>(sum);
+        for (int i = 0; i < S; ++i) {
+            r[i] = (t[i] >> Shift) | (t[i + 1] << (64 - Shift));
+        }
+        // -m < r < 2m
+        auto high = static_cast<int64_t>(t[S]) >> Shift;
+        if (high < 0) {
+            add<S>(r, r, m);
+        } else if (high != 0 || cmp<S>(r, m) >= 0) {
+            sub<S>(r, r, m);
+        }
+    }
+    // binary GCD of numbers that fit in one limb (b odd), returns gcd(a, b)
+    ALWAYS_INLINE Limb binaryGcd64(Limb a, Limb b) {
+        if (a == 0) {
+            return b;
+        }
+        // both odd, |a - b| has the same trailing zeros as a - b
+        a >>= ::trailingZeroBitCount(a);
+        while (a != b) {
+            Limb d = a - b;
+            auto zeros = ::trailingZeroBitCount(d);
+            Limb swapMask = 0 - static_cast<Limb>(a < b);
+            b += d & swapMask;
+            a = ((d ^ swapMask) - swapMask) >> zeros;
+        }
+        return a;
+    }
+    // runs binary GCD until a = 0, then b is the gcd (b has to be odd)
+    template<int S, bool IsInverting> void binaryGcd(Int a, Int b, Int u, Int v, ConstInt m, Limb mInverse) {
+        std::array<int64_t, 4> pending;
+        bool hasPendingMatrix = false;
+        while (!isZero<S>(a)) {
+            auto bits = std::max(sizeInBits<S>(a), sizeInBits<S>(b));
+            if constexpr (!IsInverting) {
+                // the rest is faster with ordinary binary GCD
+                if (bits <= 64) {
+                    b[0] = binaryGcd64(a[0], b[0]);
+                    clear<S>(a);
+                    return;
+                }
+            }
+            int64_t f0, g0, f1, g1;
+            binaryGcdInnerSteps(binaryGcdApproximation<S>(a, bits), binaryGcdApproximation<S>(b, bits), f0, g0, f1, g1);
+            binaryGcdUpdate<S>(a, b, f0, g0, f1, g1, (bits + 63) / 64);
+            if constexpr (IsInverting) {
+                // u and v are updated every second iteration with the product of both matrices
+                if (!hasPendingMatrix) {
+                    pending = { f0, g0, f1, g1 };
+                    hasPendingMatrix = true;
+                    continue;
+                }
+                hasPendingMatrix = false;
+                Limb newU[S];
+                binaryGcdCoefficient<S, 2 * BinaryGcdInnerSteps>(newU, u, f0 * pending[0] + g0 * pending[2], v, f0 * pending[1] + g0 * pending[3], m, mInverse);
+                binaryGcdCoefficient<S, 2 * BinaryGcdInnerSteps>(v, u, f1 * pending[0] + g1 * pending[2], v, f1 * pending[1] + g1 * pending[3], m, mInverse);
+                copy<S>(u, newU);
+            }
+        }
+        if constexpr (IsInverting) {
+            if (hasPendingMatrix) {
+                Limb newU[S];
+                binaryGcdCoefficient<S, BinaryGcdInnerSteps>(newU, u, pending[0], v, pending[1], m, mInverse);
+                binaryGcdCoefficient<S, BinaryGcdInnerSteps>(v, u, pending[2], v, pending[3], m, mInverse);
+                copy<S>(u, newU);
+            }
+        }
+    }
+
+    // r = gcd(a, b)
+    template<int S> void gcd(Int r, ConstInt a, ConstInt b) {
+        Limb x[S];
+        Limb y[S];
+        copy<S>(x, a);
+        copy<S>(y, b);
+        if (isZero<S>(x) || isZero<S>(y)) {
+            for (int i = 0; i < S; ++i) {
+                r[i] = x[i] | y[i];
+            }
+            return;
+        }
+        auto shift = std::min(trailingZeroBitCount<S>(x), trailingZeroBitCount<S>(y));
+        shr<S, S>(x, x, shift);
+        shr<S, S>(y, y, shift);
+        if (y[0] % 2 == 0) {
+            for (int i = 0; i < S; ++i) {
+                std::swap(x[i], y[i]);
+            }
+        }
+        // GMP's hand-written 2-limb GCD (mpn_gcd_22) is faster than binary GCD, it needs x >= y and one of them odd
+        if constexpr (S == 2) {
+            if (cmp<S>(x, y) < 0) {
+                std::swap(x[0], y[0]);
+                std::swap(x[1], y[1]);
+            }
+            clear<S>(r);
+            mpn_gcd(r, x, realSize<S>(x), y, realSize<S>(y));
+            shl<S, S>(r, r, shift);
+            return;
+        }
+        binaryGcd<S, false>(x, y, nullptr, nullptr, nullptr, 0);
+        shl<S, S>(r, y, shift);
+    }
+    // r = (a^-1) % m
+    template<int S> void modInv(Int r, ConstInt a, ConstInt m) {
+        // binary GCD is clearly faster than GMP only for 2-6 limbs
+        if (S == 1 || S >= 7 || m[0] % 2 == 0) {
+            modInvGmp<S>(r, a, m);
+            return;
+        }
+        // 5 correct bits, doubled by every Newton step
+        Limb mInverse = (3 * m[0]) ^ 2;
+        for (int i = 0; i < 4; ++i) {
+            mInverse *= 2 - m[0] * mInverse;
+        }
+        mInverse = 0 - mInverse;
+        Limb x[S];
+        Limb y[S];
+        Limb u[S];
+        copy<S>(x, a);
+        copy<S>(y, m);
+        clear<S>(u);
+        u[0] = 1;
+        clear<S>(r);
+        binaryGcd<S, true>(x, y, u, r, m, mInverse);
+    }
+
     // modulo operation using Barret Reduction algorithm
     template<int S> void modBarret(Int r, ConstInt a, ConstInt mod, ConstInt R, uint32_t k) {
         if (cmp<2*S,S>(a, mod) < 0) {
@@ -805,6 +1069,19 @@ namespace bigIntKernels {
         mod<S, 2 * S, S>(r, mulRes, n);
     }
 
+    #ifdef MULX_ASM_IS_AVAILABLE
+    // r = A*B*R^-1 mod m with MULX/ADX assembly (before the last subtraction the result can be up to 2m, so it may not fit S limbs)
+    template<int S> void montgomeryMultMulxReduced(Int r, ConstInt A, ConstInt B, ConstInt k, ConstInt m) {
+        auto carry = montgomeryMultMulx<S>(r, A, B, k[0], m);
+        if (carry != 0 || cmp<S>(r, m) >= 0) {
+            uint8_t borrow = 0;
+            for (int i = 0; i < S; ++i) {
+                borrow = subBorrow(borrow, r[i], r[i], m[i]);
+            }
+        }
+    }
+    #endif
+
     template<int S> void montgomeryMult(Int r, ConstInt A, ConstInt B, ConstInt k, ConstInt m, uint32_t b) {
         #ifdef USE_ASM_LIB
         if constexpr (S > 1 && S <= 6) {
@@ -818,6 +1095,13 @@ namespace bigIntKernels {
             if constexpr (S == 8) montgomeryMult8(r, A, B, k, m, b);
             return;
         }
+        #elif defined(MULX_ASM_IS_AVAILABLE)
+        if constexpr (S > 1 && S <= 6) {
+            if (mulxAsmIsSupported()) {
+                montgomeryMultMulxReduced<S>(r, A, B, k, m);
+                return;
+            }
+        }
         #endif
         uint64_t t[2 * S];
         uint64_t s[2 * S];
@@ -847,7 +1131,7 @@ namespace bigIntKernels {
                 }
             } else {
                 mpn_mul(s, r, S, m, S);
-                mpn_add(t, s, 2 * S, t, S);
+                mpn_add_n(t, t, s, 2 * S); // t + r * m < 2^(128S) for m below 2^(64S-1)
             }
         }
         copy<S>(r, t + S);
@@ -868,6 +1152,13 @@ namespace bigIntKernels {
             if constexpr (S == 8) montgomerySqr8(r, A, k, m, b);
             return;
         }
+        #elif defined(MULX_ASM_IS_AVAILABLE)
+        if constexpr (S > 1 && S <= 6) {
+            if (mulxAsmIsSupported()) {
+                montgomeryMultMulxReduced<S>(r, A, A, k, m);
+                return;
+            }
+        }
         #endif
         uint64_t t[2 * S];
         uint64_t s[2 * S];
@@ -893,7 +1184,7 @@ namespace bigIntKernels {
                 }
             } else {
                 mpn_mul(s, r, S, m, S);
-                mpn_add(t, s, 2 * S, t, S);
+                mpn_add_n(t, t, s, 2 * S); // t + r * m < 2^(128S) for m below 2^(64S-1)
             }
         }
         copy<S>(r, t + S);
@@ -902,6 +1193,200 @@ namespace bigIntKernels {
         }
     }
 
+    /*
+        Lane kernels operate on L independent numbers (lanes) of D 52-bit digits each.
+        Digits are stored digit-major (digit d of lane l is at a[d * L + l]), so that one SIMD register holds
+        the same digit of all lanes. 52-bit digits match the AVX-512 IFMA multiplier, which is used if available.
+    */
+    constexpr Limb LaneDigitMask = (1ull << 52) - 1;
+
+    // r = a >= m ? a - m : a (for normalized a < 2m)
+    template<int D, int L> ALWAYS_INLINE void reduceOnceLanes(Int r, ConstInt a, ConstInt m) {
+        Limb borrow[L] = {};
+        Limb d[D * L];
+        for (int j = 0; j < D; ++j) {
+            for (int l = 0; l < L; ++l) {
+                auto s = a[j * L + l] - m[j * L + l] - borrow[l];
+                borrow[l] = s >> 63;
+                d[j * L + l] = s & LaneDigitMask;
+            }
+        }
+        for (int j = 0; j < D; ++j) {
+            for (int l = 0; l < L; ++l) {
+                r[j * L + l] = borrow[l] ? a[j * L + l] : d[j * L + l];
+            }
+        }
+    }
+    template<int D, int L> void modAddLanes(Int r, ConstInt a, ConstInt b, ConstInt m) {
+        #ifdef AVX512_IFMA_IS_AVAILABLE
+        if constexpr (L == 8) {
+            // the carry and borrow chains go across digits, so they don't get vectorized automatically
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i mask = _mm512_set1_epi64(LaneDigitMask);
+            __m512i carry = zero;
+            __m512i borrow = zero;
+            __m512i t[D];
+            __m512i d[D];
+            for (int j = 0; j < D; ++j) {
+                __m512i s = _mm512_add_epi64(_mm512_add_epi64(_mm512_loadu_si512(a + j * L), _mm512_loadu_si512(b + j * L)), carry);
+                carry = _mm512_maskz_srli_epi64(0xFF, s, 52);
+                t[j] = _mm512_and_si512(s, mask);
+                s = _mm512_sub_epi64(_mm512_sub_epi64(t[j], _mm512_loadu_si512(m + j * L)), borrow);
+                borrow = _mm512_maskz_srli_epi64(0xFF, s, 63);
+                d[j] = _mm512_and_si512(s, mask);
+            }
+            __mmask8 isReduced = _mm512_cmpeq_epi64_mask(borrow, zero);
+            for (int j = 0; j < D; ++j) {
+                _mm512_storeu_si512(r + j * L, _mm512_mask_blend_epi64(isReduced, t[j], d[j]));
+            }
+            return;
+        }
+        #endif
+        Limb t[D * L];
+        Limb carry[L] = {};
+        for (int j = 0; j < D; ++j) {
+            for (int l = 0; l < L; ++l) {
+                auto s = a[j * L + l] + b[j * L + l] + carry[l];
+                carry[l] = s >> 52;
+                t[j * L + l] = s & LaneDigitMask;
+            }
+        }
+        reduceOnceLanes<D, L>(r, t, m);
+    }
+    template<int D, int L> void modSubLanes(Int r, ConstInt a, ConstInt b, ConstInt m) {
+        #ifdef AVX512_IFMA_IS_AVAILABLE
+        if constexpr (L == 8) {
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i mask = _mm512_set1_epi64(LaneDigitMask);
+            __m512i borrow = zero;
+            __m512i t[D];
+            for (int j = 0; j < D; ++j) {
+                __m512i s = _mm512_sub_epi64(_mm512_sub_epi64(_mm512_loadu_si512(a + j * L), _mm512_loadu_si512(b + j * L)), borrow);
+                borrow = _mm512_maskz_srli_epi64(0xFF, s, 63);
+                t[j] = _mm512_and_si512(s, mask);
+            }
+            // add m back to the lanes that went below zero
+            __mmask8 isNegative = _mm512_cmpneq_epi64_mask(borrow, zero);
+            __m512i carry = zero;
+            for (int j = 0; j < D; ++j) {
+                __m512i s = _mm512_add_epi64(_mm512_mask_add_epi64(t[j], isNegative, t[j], _mm512_loadu_si512(m + j * L)), carry);
+                carry = _mm512_maskz_srli_epi64(0xFF, s, 52);
+                _mm512_storeu_si512(r + j * L, _mm512_and_si512(s, mask));
+            }
+            return;
+        }
+        #endif
+        Limb t[D * L];
+        Limb borrow[L] = {};
+        for (int j = 0; j < D; ++j) {
+            for (int l = 0; l < L; ++l) {
+                auto s = a[j * L + l] - b[j * L + l] - borrow[l];
+                borrow[l] = s >> 63;
+                t[j * L + l] = s & LaneDigitMask;
+            }
+        }
+        Limb carry[L] = {};
+        for (int j = 0; j < D; ++j) {
+            for (int l = 0; l < L; ++l) {
+                auto s = t[j * L + l] + (m[j * L + l] & (0 - borrow[l])) + carry[l];
+                carry[l] = s >> 52;
+                r[j * L + l] = s & LaneDigitMask;
+            }
+        }
+    }
+
+    // r = A*B / 2^(52*D) mod m (word-serial Montgomery multiplication with lazy carries), k = -m^-1 mod 2^52
+    template<int D, int L> void montgomeryMultLanes(Int r, ConstInt A, ConstInt B, ConstInt k, ConstInt m) {
+        #ifdef AVX512_IFMA_IS_AVAILABLE
+        if constexpr (L == 8) {
+            const __m512i zero = _mm512_setzero_si512();
+            __m512i t[D + 1];
+            __m512i a[D];
+            __m512i mm[D];
+            for (int j = 0; j <= D; ++j) t[j] = zero;
+            for (int j = 0; j < D; ++j) {
+                a[j] = _mm512_loadu_si512(A + j * L);
+                mm[j] = _mm512_loadu_si512(m + j * L);
+            }
+            __m512i kk = _mm512_loadu_si512(k);
+            for (int i = 0; i < D; ++i) {
+                __m512i bi = _mm512_loadu_si512(B + i * L);
+                for (int j = 0; j < D; ++j) t[j] = _mm512_madd52lo_epu64(t[j], a[j], bi);
+                for (int j = 0; j < D; ++j) t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], a[j], bi);
+                __m512i q = _mm512_madd52lo_epu64(zero, t[0], kk);
+                for (int j = 0; j < D; ++j) t[j] = _mm512_madd52lo_epu64(t[j], mm[j], q);
+                for (int j = 0; j < D; ++j) t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], mm[j], q);
+                t[0] = _mm512_add_epi64(t[1], _mm512_maskz_srli_epi64(0xFF, t[0], 52));
+                for (int j = 1; j < D; ++j) t[j] = t[j + 1];
+                t[D] = zero;
+            }
+            const __m512i mask = _mm512_set1_epi64(LaneDigitMask);
+            __m512i carry = zero;
+            __m512i borrow = zero;
+            __m512i d[D];
+            for (int j = 0; j < D; ++j) {
+                t[j] = _mm512_add_epi64(t[j], carry);
+                carry = _mm512_maskz_srli_epi64(0xFF, t[j], 52);
+                t[j] = _mm512_and_si512(t[j], mask);
+                __m512i s = _mm512_sub_epi64(_mm512_sub_epi64(t[j], mm[j]), borrow);
+                borrow = _mm512_maskz_srli_epi64(0xFF, s, 63);
+                d[j] = _mm512_and_si512(s, mask);
+            }
+            __mmask8 isReduced = _mm512_cmpeq_epi64_mask(borrow, zero);
+            for (int j = 0; j < D; ++j) {
+                _mm512_storeu_si512(r + j * L, _mm512_mask_blend_epi64(isReduced, t[j], d[j]));
+            }
+            return;
+        }
+        #endif
+        Limb t[(D + 1) * L] = {};
+        for (int i = 0; i < D; ++i) {
+            Limb q[L];
+            for (int j = 0; j < D; ++j) {
+                for (int l = 0; l < L; ++l) {
+                    Limb hi, lo;
+                    mul128(hi, lo, A[j * L + l], B[i * L + l]);
+                    t[j * L + l] += lo & LaneDigitMask;
+                    t[(j + 1) * L + l] += (hi << 12) | (lo >> 52);
+                }
+            }
+            for (int l = 0; l < L; ++l) {
+                q[l] = (t[l] * k[l]) & LaneDigitMask;
+            }
+            for (int j = 0; j < D; ++j) {
+                for (int l = 0; l < L; ++l) {
+                    Limb hi, lo;
+                    mul128(hi, lo, m[j * L + l], q[l]);
+                    t[j * L + l] += lo & LaneDigitMask;
+                    t[(j + 1) * L + l] += (hi << 12) | (lo >> 52);
+                }
+            }
+            for (int l = 0; l < L; ++l) {
+                t[l] = t[L + l] + (t[l] >> 52);
+            }
+            for (int j = 1; j < D; ++j) {
+                for (int l = 0; l < L; ++l) {
+                    t[j * L + l] = t[(j + 1) * L + l];
+                }
+            }
+            for (int l = 0; l < L; ++l) {
+                t[D * L + l] = 0;
+            }
+        }
+        Limb carry[L] = {};
+        for (int j = 0; j < D; ++j) {
+            for (int l = 0; l < L; ++l) {
+                t[j * L + l] += carry[l];
+                carry[l] = t[j * L + l] >> 52;
+                t[j * L + l] &= LaneDigitMask;
+            }
+        }
+        reduceOnceLanes<D, L>(r, t, m);
+    }
+    template<int D, int L> void montgomerySqrLanes(Int r, ConstInt A, ConstInt k, ConstInt m) {
+        montgomeryMultLanes<D, L>(r, A, A, k, m);
+    }
+
     uint64_t div(uint64_t a, uint64_t m, uint32_t lm1) {
         uint64_t t1, t0;
         mul128(t1, t0, m, a);
@@ -0,0 +1,174 @@
+#pragma once
+#include "../BigInt/BigIntGmp.h"
+#include "../BigInt/BigInt.h"
+#include "../PrecomputedTables/primeSieve.h"
+#include <gmp.h>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+/*
+    Trial division of many numbers at once with Bernstein's product/remainder trees:
+    1. P = product of all primes up to bound (a product tree built once, BatchTrialDivisionPrimes),
+    2. P mod n_i for all inputs with a remainder tree over the product tree of inputs,
+       then g_i = gcd(P mod n_i, n_i) is the product of all distinct primes up to bound dividing n_i,
+    3. G = product of all g_i goes down the remainder tree of primes, a prime p divides some input if it divides G,
+    4. every g_i is split into these primes by descending their product tree (gcd with both children),
+       and the primes are divided out of n_i with multiplicity.
+    Every step is quasi-linear in the total size of inputs and primes, instead of one division per prime and input.
+*/
+constexpr int BatchTrialDivisionPrimesPerLeaf = 32; // leaves of the prime tree are products of this many primes
+
+// levels[0] are the leaves, levels.back()[0] is the product of all of them
+struct ProductTree {
+    std::vector<std::vector<BigIntGmp>> levels;
+    const BigIntGmp& root() const { return levels.back()[0]; }
+};
+ProductTree productTree(std::vector<BigIntGmp> leaves) {
+    if (leaves.empty()) {
+        leaves.emplace_back(1); // empty product
+    }
+    ProductTree tree;
+    tree.levels.emplace_back(std::move(leaves));
+    while (tree.levels.back().size() > 1) {
+        auto& level = tree.levels.back();
+        std::vector<BigIntGmp> nextLevel((level.size() + 1) / 2);
+        for (std::size_t i = 0; i + 1 < level.size(); i += 2) {
+            mpz_mul(nextLevel[i / 2].data, level[i].data, level[i + 1].data);
+        }
+        if (level.size() % 2 == 1) {
+            nextLevel.back() = level.back();
+        }
+        tree.levels.emplace_back(std::move(nextLevel));
+    }
+    return tree;
+}
+// x mod every leaf of the tree, reduced from the root down
+std::vector<BigIntGmp> remainderTree(const BigIntGmp& x, const ProductTree& tree) {
+    std::vector<BigIntGmp> remainders(1);
+    mpz_mod(remainders[0].data, x.data, tree.root().data);
+    for (auto level = tree.levels.size() - 1; level-- > 0;) {
+        auto& nodes = tree.levels[level];
+        std::vector<BigIntGmp> nextRemainders(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            mpz_mod(nextRemainders[i].data, remainders[i / 2].data, nodes[i].data);
+        }
+        remainders = std::move(nextRemainders);
+    }
+    return remainders;
+}
+
+// product tree of all primes up to bound, independent of the inputs, so it is meant to be built once
+struct BatchTrialDivisionPrimes {
+    explicit BatchTrialDivisionPrimes(uint64_t bound) : bound(bound) {
+        if (bound > std::numeric_limits<uint32_t>::max()) {
+            throw std::invalid_argument("batch trial division bound must fit in 32 bits");
+        }
+        for (auto p : PrimeSieve(2, bound)) {
+            primes.push_back(static_cast<uint32_t>(p));
+        }
+        std::vector<BigIntGmp> leaves((primes.size() + BatchTrialDivisionPrimesPerLeaf - 1) / BatchTrialDivisionPrimesPerLeaf);
+        for (std::size_t i = 0; i < primes.size(); ++i) {
+            auto& leaf = leaves[i / BatchTrialDivisionPrimesPerLeaf];
+            if (i % BatchTrialDivisionPrimesPerLeaf == 0) {
+                mpz_set_ui(leaf.data, primes[i]);
+            } else {
+                mpz_mul_ui(leaf.data, leaf.data, primes[i]);
+            }
+        }
+        tree = productTree(std::move(leaves));
+    }
+    uint64_t bound;
+    std::vector<uint32_t> primes;
+    ProductTree tree;
+};
+
+struct BatchTrialDivisionResult {
+    std::vector<uint64_t> factors; // primes up to bound with multiplicity, in increasing order
+    BigIntGmp cofactor;            // n divided by all factors
+};
+
+// primes of the tree dividing g (descends only into subtrees whose product has a common factor with g)
+void collectPrimeDivisors(std::vector<uint64_t>& divisors, const BigIntGmp& g, const ProductTree& tree, std::size_t level, std::size_t index) {
+    BigIntGmp d;
+    mpz_gcd(d.data, g.data, tree.levels[level][index].data);
+    if (mpz_cmp_ui(d.data, 1) == 0) {
+        return;
+    }
+    if (level == 0) {
+        divisors.push_back(mpz_get_ui(tree.levels[0][index].data));
+        return;
+    }
+    for (auto child = 2 * index; child < std::min(2 * index + 2, tree.levels[level - 1].size()); ++child) {
+        collectPrimeDivisors(divisors, d, tree, level - 1, child);
+    }
+}
+
+std::vector<BatchTrialDivisionResult> batchTrialDivision(const BatchTrialDivisionPrimes& primes, std::span<const BigIntGmp> numbers) {
+    std::vector<BatchTrialDivisionResult> results(numbers.size());
+    if (numbers.empty()) {
+        return results;
+    }
+    for (auto& n : numbers) {
+        if (mpz_sgn(n.data) == 0) {
+            throw std::invalid_argument("batch trial division of zero"); // every prime divides it
+        }
+    }
+    // g_i = gcd(P mod n_i, n_i)
+    auto inputRemainders = remainderTree(primes.tree.root(), productTree(std::vector<BigIntGmp>(numbers.begin(), numbers.end())));
+    std::vector<BigIntGmp> smoothParts(numbers.size());
+    BigIntGmp allSmoothParts = 1;
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+        mpz_gcd(smoothParts[i].data, inputRemainders[i].data, numbers[i].data);
+        mpz_mul(allSmoothParts.data, allSmoothParts.data, smoothParts[i].data);
+    }
+
+    // primes dividing any input
+    std::vector<BigIntGmp> hitPrimes;
+    if (mpz_cmp_ui(allSmoothParts.data, 1) != 0) {
+        auto leafRemainders = remainderTree(allSmoothParts, primes.tree);
+        for (std::size_t leaf = 0; leaf < leafRemainders.size(); ++leaf) {
+            auto end = std::min(primes.primes.size(), (leaf + 1) * BatchTrialDivisionPrimesPerLeaf);
+            for (auto i = leaf * BatchTrialDivisionPrimesPerLeaf; i < end; ++i) {
+                if (mpz_divisible_ui_p(leafRemainders[leaf].data, primes.primes[i])) {
+                    hitPrimes.emplace_back(primes.primes[i]);
+                }
+            }
+        }
+    }
+
+    ProductTree hitTree;
+    if (!hitPrimes.empty()) {
+        hitTree = productTree(std::move(hitPrimes));
+    }
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+        auto& result = results[i];
+        result.cofactor = numbers[i];
+        if (mpz_cmp_ui(smoothParts[i].data, 1) == 0) {
+            continue;
+        }
+        std::vector<uint64_t> divisors;
+        collectPrimeDivisors(divisors, smoothParts[i], hitTree, hitTree.levels.size() - 1, 0);
+        for (auto p : divisors) {
+            while (mpz_divisible_ui_p(result.cofactor.data, p)) {
+                mpz_divexact_ui(result.cofactor.data, result.cofactor.data, p);
+                result.factors.push_back(p);
+            }
+        }
+    }
+    return results;
+}
+std::vector<BatchTrialDivisionResult> batchTrialDivision(std::span<const BigIntGmp> numbers, uint64_t bound) {
+    return batchTrialDivision(BatchTrialDivisionPrimes(bound), numbers);
+}
+std::vector<BatchTrialDivisionResult> batchTrialDivision(const BatchTrialDivisionPrimes& primes, std::span<const BigInt> numbers) {
+    std::vector<BigIntGmp> values;
+    values.reserve(numbers.size());
+    for (auto& n : numbers) {
+        values.emplace_back(n.visit([](auto&& a) { return BigIntGmp{ a.mod }; }));
+    }
+    return batchTrialDivision(primes, values);
+}
@@ -290,7 +290,7 @@ namespace bytecode {
 
 
         // PRAC
-        void pracSTART() { buffer.push((uint8_t)Block::Prac); }
+        void pracSTART() { buffer.push((uint8_t)Block::Prac); pracLastByte = 0; }
         void pracEND()   { buffer.push((uint8_t)PracOpCode::End); }
         void pracRule(uint8_t ruleNr, bool swapBefore) {
             uint8_t byte = (uint8_t)(swapBefore << 4) | ruleNr;
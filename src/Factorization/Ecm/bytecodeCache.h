@@ -0,0 +1,161 @@
+#pragma once
+#include "../../PrecomputedTables/tableFile.h"
+#include "curves/common.h"
+#include "common.h"
+#include <cstdint>
+#include <cstdlib>
+#include <compare>
+#include <string>
+#include <vector>
+#include <span>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <algorithm>
+
+/*
+    Stage 1 bytecode depends only on EcmBytecodeKey, so it is created once and kept in a table file shared
+    by all runs and processes: an index section sorted by key and one section with all bytecodes, both used
+    from the memory mapping. On a miss the bytecode is created and the file is rewritten with it (merged with
+    the current contents of the file, which other processes could have changed since it was mapped). The rewrite
+    holds TableFileLock, so concurrent processes do not drop each other's bytecodes.
+    Last EcmBytecodeCacheCapacity bytecodes used by the process are also kept in memory.
+    File name can be changed with ECM_BYTECODE_CACHE_FILE environment variable (empty name disables the file).
+*/
+constexpr uint32_t EcmBytecodeCacheVersion = 4; // has to be changed whenever the bytecode format changes
+constexpr std::size_t EcmBytecodeCacheCapacity = 16;
+
+enum EcmBytecodeCacheSectionId : uint32_t {
+    EcmBytecodeIndexSectionId = 1,
+    EcmBytecodeDataSectionId,
+};
+
+struct EcmBytecodeKey {
+    uint64_t B1;
+    uint32_t mulMethod;
+    uint32_t cascadeMethod;
+    uint32_t curveForm;
+
+    auto operator<=>(const EcmBytecodeKey&) const = default;
+};
+EcmBytecodeKey ecmBytecodeKey(uint64_t B1, EcmMulMethod mulMethod, EcmMulCascadeMethod cascadeMethod, EllipticCurveForm curveForm) {
+    return {
+        B1,
+        static_cast<uint32_t>(mulMethod),
+        static_cast<uint32_t>(cascadeMethod),
+        static_cast<uint32_t>(curveForm)
+    };
+}
+
+struct EcmBytecodeIndexEntry {
+    EcmBytecodeKey key;
+    uint64_t offset; // in the data section
+    uint64_t size;
+    int64_t primeCount;
+};
+
+// bytecode and the number of primes it multiplies by
+using EcmBytecode = std::pair<std::vector<uint8_t>, int>;
+
+struct EcmBytecodeCache {
+    explicit EcmBytecodeCache(std::string fileName) : fileName(std::move(fileName)) {
+        load();
+    }
+
+    // bytecode for the key, created with create() (and saved to the file) if it is not cached
+    template<typename Create> EcmBytecode get(const EcmBytecodeKey& key, Create&& create) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (auto it = recent.find(key); it != recent.end()) {
+            used.splice(used.begin(), used, it->second);
+            return it->second->second;
+        }
+        EcmBytecode bytecode;
+        if (!find(key, bytecode)) {
+            bytecode = create();
+            save(key, bytecode);
+        }
+        used.emplace_front(key, bytecode);
+        recent[key] = used.begin();
+        if (used.size() > EcmBytecodeCacheCapacity) {
+            recent.erase(used.back().first);
+            used.pop_back();
+        }
+        return bytecode;
+    }
+
+private:
+    void load() {
+        file = fileName.empty() ? TableFile{} : TableFile(fileName, EcmBytecodeCacheVersion);
+        index = file.section<EcmBytecodeIndexEntry>(EcmBytecodeIndexSectionId);
+        data = file.section<uint8_t>(EcmBytecodeDataSectionId);
+    }
+    bool find(const EcmBytecodeKey& key, EcmBytecode& out_bytecode) const {
+        auto it = std::lower_bound(index.begin(), index.end(), key, [](const EcmBytecodeIndexEntry& entry, const EcmBytecodeKey& key) {
+            return entry.key < key;
+        });
+        if (it == index.end() || it->key != key || it->offset > data.size() || it->size > data.size() - it->offset) {
+            return false;
+        }
+        auto bytes = data.subspan(it->offset, it->size);
+        out_bytecode = { std::vector<uint8_t>(bytes.begin(), bytes.end()), static_cast<int>(it->primeCount) };
+        return true;
+    }
+    // it is fine if it fails, the bytecode is then only kept in memory
+    void save(const EcmBytecodeKey& key, const EcmBytecode& bytecode) {
+        if (fileName.empty()) {
+            return;
+        }
+        // without the lock two processes could both merge into the same old contents and one bytecode would be lost
+        TableFileLock lock(fileName);
+        load();
+        EcmBytecode saved;
+        if (find(key, saved)) {
+            return;
+        }
+        std::vector<EcmBytecodeIndexEntry> newIndex;
+        std::vector<uint8_t> newData;
+        auto add = [&](const EcmBytecodeKey& entryKey, std::span<const uint8_t> bytes, int64_t primeCount) {
+            newIndex.push_back({ entryKey, newData.size(), bytes.size(), primeCount });
+            newData.insert(newData.end(), bytes.begin(), bytes.end());
+        };
+        bool isAdded = false;
+        for (auto& entry : index) {
+            if (!isAdded && key < entry.key) {
+                add(key, bytecode.first, bytecode.second);
+                isAdded = true;
+            }
+            if (entry.offset <= data.size() && entry.size <= data.size() - entry.offset) {
+                add(entry.key, data.subspan(entry.offset, entry.size), entry.primeCount);
+            }
+        }
+        if (!isAdded) {
+            add(key, bytecode.first, bytecode.second);
+        }
+        auto contents = buildTableFile(EcmBytecodeCacheVersion, {
+            { EcmBytecodeIndexSectionId, sizeof(EcmBytecodeIndexEntry), newIndex.data(), newIndex.size() },
+            { EcmBytecodeDataSectionId, sizeof(uint8_t), newData.data(), newData.size() },
+        });
+        if (saveTableFile(fileName, contents)) {
+            load();
+        }
+    }
+
+    std::string fileName;
+    TableFile file;
+    std::span<const EcmBytecodeIndexEntry> index;
+    std::span<const uint8_t> data;
+
+    std::mutex mutex;
+    std::list<std::pair<EcmBytecodeKey, EcmBytecode>> used; // most recently used first
+    std::map<EcmBytecodeKey, std::list<std::pair<EcmBytecodeKey, EcmBytecode>>::iterator> recent;
+};
+
+std::string ecmBytecodeCacheFileName() {
+    auto fileName = std::getenv("ECM_BYTECODE_CACHE_FILE");
+    return fileName ? fileName : "Ecm_Bytecode_Cache.dat";
+}
+EcmBytecodeCache& ecmBytecodeCache() {
+    static EcmBytecodeCache cache(ecmBytecodeCacheFileName());
+    return cache;
+}
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../../PrecomputedTables/primeTable.h"
+#include "../../PrecomputedTables/primeSieve.h"
 #include "curves/common.h"
 #include "curves/twistedEdwards.h"
 #include "common.h"
@@ -8,6 +8,8 @@
 #include "multiplicationMethods/wnafMul.h"
 #include "multiplicationMethods/pracMul.h"
 #include "bytecode.h"
+#include "bytecodeCache.h"
+#include <stdexcept>
 
 template<typename Type, typename ModType>
 void cascadeMulDoMultiplication(EcmContext& context, EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, uint64_t n) {
@@ -39,28 +41,35 @@ void cascadeMulDoMultiplication(EcmContext& context, EllipticCurve<Type, ModType
 template<typename Type, typename ModType> 
 int ecmStage1Mul(EcmContext& context, EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& point) {
     int i = 0;
+    uint64_t firstPrime = 2;
     if (context.mulMethod == EcmMulMethod::Prac) {
         // prac requires multiplicands > 2
         for (uint64_t r = 2; r <= context.B1; r *= 2) {
             dbl(curve, point);
             context.out_dblCount += 1;
         }
-        i = 2;
+        i = 1;
+        firstPrime = 3;
+        if (context.mulCascadeMethod == EcmMulCascadeMethod::MaxUntil256Overflow || context.mulCascadeMethod == EcmMulCascadeMethod::Full) {
+            throw std::invalid_argument("PRAC is not supported with MaxUntil256Overflow and Full cascades");
+        }
     } 
     if (context.mulCascadeMethod == EcmMulCascadeMethod::Seperate) {
-        for (; Primes_1_000_000[i] <= context.B1; ++i) {
-            for (uint64_t p = Primes_1_000_000[i]; p <= context.B1; p *= Primes_1_000_000[i]) {
-                cascadeMulDoMultiplication(context, curve, point, (uint64_t)Primes_1_000_000[i]);
+        for (auto prime : PrimeSieve(firstPrime, context.B1)) {
+            ++i;
+            for (uint64_t p = prime; p <= context.B1; p *= prime) {
+                cascadeMulDoMultiplication(context, curve, point, prime);
             }
         }
     } 
     else if (context.mulCascadeMethod == EcmMulCascadeMethod::Powers) {
-        for (; Primes_1_000_000[i] <= context.B1; ++i) {
-            uint64_t p = Primes_1_000_000[i];
+        for (auto prime : PrimeSieve(firstPrime, context.B1)) {
+            ++i;
+            uint64_t p = prime;
             uint64_t q;
             do {
                 q = p;
-                p *= Primes_1_000_000[i];
+                p *= prime;
             } while (p <= context.B1);
             cascadeMulDoMultiplication(context, curve, point, q);
         }
@@ -69,16 +78,17 @@ int ecmStage1Mul(EcmContext& context, EllipticCurve<Type, ModType>& curve, Curve
         uint64_t x = 1;
         uint64_t y = 1;
         // TODO: something is wrong here, not the same result as Seperate and Powers method.
-        for (; Primes_1_000_000[i] <= context.B1; ++i) {
-            uint64_t p = Primes_1_000_000[i];
+        for (auto prime : PrimeSieve(firstPrime, context.B1)) {
+            ++i;
+            uint64_t p = prime;
             do {
-                y *= Primes_1_000_000[i];
+                y *= prime;
                 if (x > y || y > (1ull << 63)) {
                     cascadeMulDoMultiplication(context, curve, point, x);
-                    y = Primes_1_000_000[i];
+                    y = prime;
                 }
                 x = y;
-                p *= Primes_1_000_000[i];
+                p *= prime;
             } while (p <= context.B1);
         }
         cascadeMulDoMultiplication(context, curve, point, x);
@@ -88,16 +98,17 @@ int ecmStage1Mul(EcmContext& context, EllipticCurve<Type, ModType>& curve, Curve
         BigIntFixedSize<4> y = 1;
         BigIntFixedSize<4> limit = MaxU64;
         shl(limit, limit, 190);
-        for (; Primes_1_000_000[i] <= context.B1; ++i) {
-            uint64_t p = Primes_1_000_000[i];
+        for (auto prime : PrimeSieve(firstPrime, context.B1)) {
+            ++i;
+            uint64_t p = prime;
             do {
-                mul(y, y, Primes_1_000_000[i]);
+                mul(y, y, prime);
                 if (x > y || y > limit) {
                     cascadeMulDoMultiplication(context, curve, point, x);
-                    y = Primes_1_000_000[i];
+                    y = prime;
                 }
                 x = y;
-                p *= Primes_1_000_000[i];
+                p *= prime;
             } while (p <= context.B1);
         }
     }
@@ -132,28 +143,52 @@ template<typename ValueType> void addBytecode(bytecode::Writer& bc, EcmMulMethod
             debugAssert(false);
         break;
     break;
-    case EcmMulMethod::Prac:         debugAssert(false);                    break;
+    case EcmMulMethod::Prac:
+        // MaxUntilOverflow keeps its products below 2^63, createBytecode rejects wider cascades
+        if constexpr (!std::is_same_v<ValueType, BigIntGmp>) {
+            debugAssert(n.sizeInBits() <= 64);
+            pracMul(bc, n[0], pracChainsToCheck);
+        } else {
+            debugAssert(false);
+        }
+        break;
     }
 }
 
-static auto DnafFullBytecodes = bytecode::readFromFile("dnaf_bytecode");
-static auto nafKleinjungBytecodes = bytecode::readFromFile("bosKleinjungNaf_bytecode");
-template<typename ModType> std::pair<std::vector<uint8_t>, int> createBytecode(const EcmContext& context, EllipticCurveForm curveForm, const ModType& modValue) {
+// pracChainsToCheck - number of PRAC chains tried for every multiplier, the cheapest one is used
+int createBytecode(bytecode::Writer& bc, uint64_t B1, EcmMulMethod mulMethod, EcmMulCascadeMethod cascadeMethod, EllipticCurveForm curveForm, int pracChainsToCheck=10);
+
+// precomputed bytecode files are read on first use
+const std::map<uint64_t, bytecode::FileData>& dnafFullBytecodes() {
+    static const auto bytecodes = bytecode::readFromFile("dnaf_bytecode");
+    return bytecodes;
+}
+const std::map<uint64_t, bytecode::FileData>& nafKleinjungBytecodes() {
+    static const auto bytecodes = bytecode::readFromFile("bosKleinjungNaf_bytecode");
+    return bytecodes;
+}
+std::pair<std::vector<uint8_t>, int> createBytecode(const EcmContext& context, EllipticCurveForm curveForm) {
+    // lookups must not insert - createBytecode can be called from multiple threads
     if (context.mulMethod == EcmMulMethod::DNaf && context.mulCascadeMethod == EcmMulCascadeMethod::Full && context.B1 <= 10000 && context.B1 % 10 == 0) {
-        return { DnafFullBytecodes[context.B1].buffer, 0 }; // TODO: change 0 to correct value
+        if (auto it = dnafFullBytecodes().find(context.B1); it != dnafFullBytecodes().end())
+            return { it->second.buffer, 0 }; // TODO: change 0 to correct value
     }
     if (context.mulMethod == EcmMulMethod::Naf && context.B1 < 1000 && context.B1 % 100 == 0) {
-        return { nafKleinjungBytecodes[context.B1].buffer, 0 }; // TODO: change 0 to correct value
+        if (auto it = nafKleinjungBytecodes().find(context.B1); it != nafKleinjungBytecodes().end())
+            return { it->second.buffer, 0 }; // TODO: change 0 to correct value
     }
-    
-    bytecode::Writer bc;
-    auto i = createBytecode(bc, context.B1, context.mulMethod, context.mulCascadeMethod, curveForm, sizeInLimbs(modValue));
-    std::vector<uint8_t> data(bc.buffer.data.begin()+48, bc.buffer.data.end());
-    return { data, i };
+
+    auto key = ecmBytecodeKey(context.B1, context.mulMethod, context.mulCascadeMethod, curveForm);
+    return ecmBytecodeCache().get(key, [&]() {
+        bytecode::Writer bc;
+        auto i = createBytecode(bc, context.B1, context.mulMethod, context.mulCascadeMethod, curveForm);
+        return EcmBytecode{ std::vector<uint8_t>(bc.buffer.data.begin()+48, bc.buffer.data.begin()+bc.buffer.size), i };
+    });
 }
-int createBytecode(bytecode::Writer& bc, uint64_t B1, EcmMulMethod mulMethod, EcmMulCascadeMethod cascadeMethod, EllipticCurveForm curveForm, int pracChainsToCheck=10) {
+int createBytecode(bytecode::Writer& bc, uint64_t B1, EcmMulMethod mulMethod, EcmMulCascadeMethod cascadeMethod, EllipticCurveForm curveForm, int pracChainsToCheck) {
     bc.START(B1);
     int i = 0;
+    uint64_t firstPrime = 2;
     //BigIntFixedSize<4> test = 1;
 
     if (mulMethod == EcmMulMethod::Prac) {
@@ -163,23 +198,30 @@ int createBytecode(bytecode::Writer& bc, uint64_t B1, EcmMulMethod mulMethod, Ec
             bc.dbChainDBL();
         }
         bc.dbChainEND();
-        i = 2;
+        i = 1;
+        firstPrime = 3;
+        // PRAC chains use 64-bit arithmetic, so multipliers of these cascades do not fit
+        if (cascadeMethod == EcmMulCascadeMethod::MaxUntil256Overflow || cascadeMethod == EcmMulCascadeMethod::Full) {
+            throw std::invalid_argument("PRAC is not supported with MaxUntil256Overflow and Full cascades");
+        }
     } 
     if (cascadeMethod == EcmMulCascadeMethod::Seperate) {
-        for (; Primes_1_000_000[i] <= B1; ++i) {
-            for (uint64_t p = Primes_1_000_000[i]; p <= B1; p *= Primes_1_000_000[i]) {
-                addBytecode(bc, mulMethod, curveForm, pracChainsToCheck, (uint64_t)Primes_1_000_000[i]);
-                //test *= Primes_1_000_000[i];
+        for (auto prime : PrimeSieve(firstPrime, B1)) {
+            ++i;
+            for (uint64_t p = prime; p <= B1; p *= prime) {
+                addBytecode(bc, mulMethod, curveForm, pracChainsToCheck, prime);
+                //test *= prime;
             }
         }
     } 
     else if (cascadeMethod == EcmMulCascadeMethod::Powers) {
-        for (; Primes_1_000_000[i] <= B1; ++i) {
-            uint64_t p = Primes_1_000_000[i];
+        for (auto prime : PrimeSieve(firstPrime, B1)) {
+            ++i;
+            uint64_t p = prime;
             uint64_t q;
             do {
                 q = p;
-                p *= Primes_1_000_000[i];
+                p *= prime;
             } while (p <= B1);
             addBytecode(bc, mulMethod, curveForm, pracChainsToCheck, q);
             //test *= q;
@@ -189,18 +231,19 @@ int createBytecode(bytecode::Writer& bc, uint64_t B1, EcmMulMethod mulMethod, Ec
         BigIntFixedSize<2> x = 1;
         BigIntFixedSize<2> y = 1;
         BigIntFixedSize<2> limit = 1ull << 63;
-        for (; Primes_1_000_000[i] <= B1; ++i) {
-            uint64_t p = Primes_1_000_000[i];
+        for (auto prime : PrimeSieve(firstPrime, B1)) {
+            ++i;
+            uint64_t p = prime;
             do {
-                //y *= Primes_1_000_000[i];
-                mul(y, y, Primes_1_000_000[i]);
+                //y *= prime;
+                mul(y, y, prime);
                 if (x > y || y >= limit) {
                     addBytecode(bc, mulMethod, curveForm, pracChainsToCheck, x);
                     //test *= x;
-                    y = Primes_1_000_000[i];
+                    y = prime;
                 }
                 x = y;
-                p *= Primes_1_000_000[i];
+                p *= prime;
             } while (p <= B1);
         }
         addBytecode(bc, mulMethod, curveForm, pracChainsToCheck, x);
@@ -211,17 +254,18 @@ int createBytecode(bytecode::Writer& bc, uint64_t B1, EcmMulMethod mulMethod, Ec
         BigIntFixedSize<4> y = 1;
         BigIntFixedSize<4> limit = 1;
         shl(limit, limit, 255);
-        for (; Primes_1_000_000[i] <= B1; ++i) {
-            uint64_t p = Primes_1_000_000[i];
+        for (auto prime : PrimeSieve(firstPrime, B1)) {
+            ++i;
+            uint64_t p = prime;
             do {
-                mul(y, y, Primes_1_000_000[i]);
+                mul(y, y, prime);
                 if (x > y || y >= limit) {
                     addBytecode(bc, mulMethod, curveForm, pracChainsToCheck, x);
                     //test *= x;
-                    y = Primes_1_000_000[i];
+                    y = prime;
                 }
                 x = y;
-                p *= Primes_1_000_000[i];
+                p *= prime;
             } while (p <= B1);
         }
         addBytecode(bc, mulMethod, curveForm, pracChainsToCheck, x);
@@ -229,11 +273,12 @@ int createBytecode(bytecode::Writer& bc, uint64_t B1, EcmMulMethod mulMethod, Ec
     }
     else if (cascadeMethod == EcmMulCascadeMethod::Full) {
         BigIntGmp x = 1;
-        for (; Primes_1_000_000[i] <= B1; ++i) {
-            uint64_t p = Primes_1_000_000[i];
+        for (auto prime : PrimeSieve(firstPrime, B1)) {
+            ++i;
+            uint64_t p = prime;
             do {
-                mul(x, x, Primes_1_000_000[i]);
-                p *= Primes_1_000_000[i];
+                mul(x, x, prime);
+                p *= prime;
             } while (p <= B1);
         }
         addBytecode(bc, mulMethod, curveForm, pracChainsToCheck, x);
@@ -4,14 +4,14 @@
 #include <vector>
 #include <functional>
 #include <iomanip>
-#include "../../../PrecomputedTables/primeTable.h"
+#include "../../../PrecomputedTables/primeSieve.h"
 #include "../multiplicationMethods/wnafMul.h"
 
 std::vector<uint64_t> createAllB1SmoothPrimes(uint64_t B1) {
     std::vector<uint64_t> result;
-    for (int i = 0; Primes_1_000_000[i] <= B1; ++i) {
-        for (uint64_t p = Primes_1_000_000[i]; p <= B1; p *= Primes_1_000_000[i]) {
-            result.emplace_back(Primes_1_000_000[i]);
+    for (auto prime : PrimeSieve(2, B1)) {
+        for (uint64_t p = prime; p <= B1; p *= prime) {
+            result.emplace_back(prime);
         }
     }
     return result;
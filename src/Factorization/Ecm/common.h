@@ -1,4 +1,5 @@
 #pragma once
+#include "../../BigInt/BigIntFixedSizeLanes.h"
 
 enum class EcmMulMethod {
     DoubleAndAdd, // Double-And-Add
@@ -8,7 +9,7 @@ enum class EcmMulMethod {
     WNaf5,        // 5NAF
     WNaf6,        // 6NAF
     DNaf,         // dynamic NAF
-    Prac          // Montgomery PRAC algorithm
+    Prac          // Montgomery PRAC algorithm (multipliers up to 64 bits, so not with MaxUntil256Overflow and Full cascades)
 };
 
 enum class EcmMulCascadeMethod {
@@ -39,6 +40,12 @@ struct EcmContext {
 
     uint64_t initialCurveSeed = MaxU64;
 
+    // number of threads processing curves in parallel (1 = run on calling thread only)
+    int threadCount = 1;
+
+    // run stage 1 of several curves at once, one curve per SIMD lane (only for fixed size Montgomery moduli)
+    bool vectorizeCurves = BigIntLanesAreVectorized;
+
     int out_dblCount = 0;
     int out_addCount = 0;
     int out_curveDoneCount = 0;
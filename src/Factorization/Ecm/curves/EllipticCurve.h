@@ -6,12 +6,6 @@
 
 TwistedEdwardsParametrization TwistedEdwardsParam = TwistedEdwardsParametrization::Old;
 
-enum class EllipticCurveForm {
-    ShortWeierstrass,
-    TwistedEdwards,
-    Montgomery,
-};
-
 template<typename ValType, typename ModType = ValType> struct EllipticCurve {
     using ValueType = ValType;
 
@@ -61,11 +55,23 @@ template<typename ValType, typename ModType = ValType> struct EllipticCurve {
             return MontgomeryGenerateCurvePoint(*this, sigma);
         }
     }
+    // initializes the same curve as calling generateNewCurveAndPoint curveIndex times after initializeCurveAndPoint(seed)
+    CurvePoint<ValType> initializeCurveAndPoint(uint64_t seed, uint64_t curveIndex) {
+        if (form == EllipticCurveForm::TwistedEdwards && TwistedEdwardsParam != TwistedEdwardsParametrization::Old) {
+            auto point = initializeCurveAndPoint(seed);
+            for (uint64_t i = 0; i < curveIndex; ++i) {
+                generateNewCurveAndPoint(point);
+            }
+            return point;
+        }
+        return initializeCurveAndPoint(seed + curveIndex);
+    }
     void generateNewCurveAndPoint(CurvePoint<ValType>& out_point) {
         switch (form) {
         case EllipticCurveForm::ShortWeierstrass:
+            // (1, 2) is on the next curve too (b = 3 - a), so out_point does not depend on its previous value
             add(a, a, getConstant(1, mod));
-            out_point.z = getConstant(1, mod);
+            out_point = CurvePoint<ValType> { getConstant(1, mod), getConstant(2, mod), getConstant(1, mod), 0 };
             break;
         case EllipticCurveForm::TwistedEdwards:
             if (TwistedEdwardsParam != TwistedEdwardsParametrization::Old) {
@@ -81,6 +87,18 @@ template<typename ValType, typename ModType = ValType> struct EllipticCurve {
             break;
         }
     }
+    // same curves and points as out_curves.size() calls of generateNewCurveAndPoint (this curve ends as the last one),
+    // Montgomery curves share a single inversion (twisted Edwards ones are generated one by one)
+    void generateNewCurvesAndPoints(std::span<EllipticCurve> out_curves, std::span<CurvePoint<ValType>> out_points) {
+        debugAssert(out_curves.size() == out_points.size());
+        if (form == EllipticCurveForm::Montgomery && out_curves.size() > 1 && montgomeryGenerateCurvesAndPoints(*this, out_curves, out_points)) {
+            return;
+        }
+        for (std::size_t i = 0; i < out_curves.size(); ++i) {
+            generateNewCurveAndPoint(out_points[i]);
+            out_curves[i] = *this;
+        }
+    }
     CurvePoint<ValType> zero() {
         switch (form) {
         case EllipticCurveForm::ShortWeierstrass: return CurvePoint<ValType> { getConstant(0, mod), getConstant(1, mod), getConstant(0, mod), 0 };
@@ -1,5 +1,6 @@
 #pragma once
 #include "../../../BigInt/modularArithmetic.h"
+#include <span>
 
 template<typename T> struct CurvePoint {
     T x;
@@ -16,6 +17,12 @@ template<typename T> std::ostream& operator<<(std::ostream& out, const CurvePoin
     return out;
 }
 
+enum class EllipticCurveForm {
+    ShortWeierstrass,
+    TwistedEdwards,
+    Montgomery,
+};
+
 enum class CoordinateSystem {
     Extended,
     Projective,
@@ -36,4 +43,28 @@ template<typename Type> CurvePoint<Type> toAffine(const CurvePoint<Type>& point,
     return result;
 }
 
+// Montgomery's trick: replaces values with their inverses using a single modular inversion and 3 multiplications per value
+// ('products' is scratch space of the same size). If the product of all values is not invertible, returns its gcd with
+// the modulus and leaves values unchanged, otherwise returns 1.
+template<typename T, typename ModType> T batchModInv(std::span<T> values, std::span<T> products, const ModType& mod) {
+    products[0] = values[0];
+    for (std::size_t i = 1; i < values.size(); ++i) {
+        modMul(products[i], products[i - 1], values[i], mod);
+    }
+    T factor = T{ 1 };
+    gcd(factor, products[values.size() - 1], mod);
+    if (factor != T{ 1 }) {
+        return factor;
+    }
+    T inverse, valueInverse;
+    modInv(inverse, products[values.size() - 1], mod);
+    for (std::size_t i = values.size() - 1; i > 0; --i) {
+        modMul(valueInverse, inverse, products[i - 1], mod);
+        modMul(inverse, inverse, values[i], mod);
+        values[i] = valueInverse;
+    }
+    values[0] = inverse;
+    return factor;
+}
+
 template<typename ValType, typename ModType> struct EllipticCurve;
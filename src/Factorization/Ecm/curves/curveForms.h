@@ -0,0 +1,62 @@
+#pragma once
+#include "common.h"
+#include "EllipticCurve.h"
+#include <array>
+#include <type_traits>
+
+/*
+    Curves with the form known at compile time. They hold only what point arithmetic of their form uses
+    (modulus, curve constant and as many temporaries as its formulas need), so loops over point operations
+    are inlined for the form, without switches on EllipticCurve::form, and the curve takes a few cache lines
+    instead of all fields of all forms. EllipticCurve stays the runtime-form type used for curve generation;
+    visitCurveForm converts it once at the boundary of such loops.
+*/
+template<typename ValType, typename ModType = ValType> struct TwistedEdwardsCurve {
+    using ValueType = ValType;
+    static constexpr EllipticCurveForm Form = EllipticCurveForm::TwistedEdwards;
+
+    ModType mod;
+    std::array<ValType, 4> tmp;
+};
+template<typename ValType, typename ModType = ValType> struct MontgomeryCurve {
+    using ValueType = ValType;
+    static constexpr EllipticCurveForm Form = EllipticCurveForm::Montgomery;
+
+    ModType mod;
+    ValType a24;
+    std::array<ValType, 6> tmp;
+};
+template<typename ValType, typename ModType = ValType> struct ShortWeierstrassCurve {
+    using ValueType = ValType;
+    static constexpr EllipticCurveForm Form = EllipticCurveForm::ShortWeierstrass;
+
+    ModType mod;
+    ValType a;
+    std::array<ValType, 5> tmp;
+};
+
+template<EllipticCurveForm Form, typename ValType, typename ModType> using CurveOfForm =
+    std::conditional_t<Form == EllipticCurveForm::TwistedEdwards, TwistedEdwardsCurve<ValType, ModType>,
+    std::conditional_t<Form == EllipticCurveForm::Montgomery,     MontgomeryCurve<ValType, ModType>,
+                                                                  ShortWeierstrassCurve<ValType, ModType>>>;
+
+template<EllipticCurveForm Form, typename ValType, typename ModType> CurveOfForm<Form, ValType, ModType> curveOfForm(const EllipticCurve<ValType, ModType>& curve) {
+    debugAssert(curve.form == Form);
+    CurveOfForm<Form, ValType, ModType> result;
+    result.mod = curve.mod;
+    if constexpr (Form == EllipticCurveForm::Montgomery) {
+        result.a24 = curve.a24;
+    } else if constexpr (Form == EllipticCurveForm::ShortWeierstrass) {
+        result.a = curve.a;
+    }
+    return result;
+}
+
+// calls f with the curve converted to the type of its form
+template<typename ValType, typename ModType, typename F> void visitCurveForm(const EllipticCurve<ValType, ModType>& curve, F&& f) {
+    switch (curve.form) {
+    case EllipticCurveForm::ShortWeierstrass: f(curveOfForm<EllipticCurveForm::ShortWeierstrass>(curve)); break;
+    case EllipticCurveForm::TwistedEdwards:   f(curveOfForm<EllipticCurveForm::TwistedEdwards>(curve));   break;
+    case EllipticCurveForm::Montgomery:       f(curveOfForm<EllipticCurveForm::Montgomery>(curve));       break;
+    }
+}
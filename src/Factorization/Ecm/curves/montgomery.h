@@ -4,9 +4,11 @@
 #include "../../../Utility/debugAssert.h"
 #include <tuple>
 #include <array>
+#include <vector>
+#include <span>
 
 // 2M + 2S + 1CM + 4D
-template<typename Type, typename ModType> void montgomeryDbl(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& r, const CurvePoint<Type>& p) {
+template<typename Curve, typename Type> void montgomeryDbl(Curve& curve, CurvePoint<Type>& r, const CurvePoint<Type>& p) {
     auto [a24, Rx, Rz, Px, Pz, u0, u1, u2, u3, u4] = modArithm::createContext(
         curve.mod, curve.a24, r.x, r.z, p.x, p.z, curve.tmp[0], curve.tmp[1], curve.tmp[2], curve.tmp[3], curve.tmp[4]
     );
@@ -20,7 +22,7 @@ template<typename Type, typename ModType> void montgomeryDbl(EllipticCurve<Type,
 }
 
 // 4M + 2S + 6D
-template<typename Type, typename ModType> void montgomeryDiffAdd(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& r, const CurvePoint<Type>& p, const CurvePoint<Type>& q, const CurvePoint<Type>& pmq) {
+template<typename Curve, typename Type> void montgomeryDiffAdd(Curve& curve, CurvePoint<Type>& r, const CurvePoint<Type>& p, const CurvePoint<Type>& q, const CurvePoint<Type>& pmq) {
     auto [Rx, Rz, Px, Pz, Qx, Qz, PmQx, PmQz, u0, u1, u2, u3, u4, u5] = modArithm::createContext(
         curve.mod, r.x, r.z, p.x, p.z, q.x, q.z, pmq.x, pmq.z, curve.tmp[0], curve.tmp[1], curve.tmp[2], curve.tmp[3], curve.tmp[4], curve.tmp[5]
     );
@@ -40,23 +42,53 @@ template<typename Type, typename ModType> void montgomeryDiffAdd(EllipticCurve<T
     }
 }
 
-template<typename Type, typename ModType> CurvePoint<Type> MontgomeryGenerateCurvePoint(EllipticCurve<Type, ModType>& curve, const Type& sigma) {
-    // Brent-Suyama parametrization
+// Brent-Suyama parametrization without its only division: returns the point, numerator and denominator of a24 = (A+2)/4
+template<typename Type, typename ModType> CurvePoint<Type> montgomeryGenerateCurvePointFraction(EllipticCurve<Type, ModType>& curve, const Type& sigma, Type& out_numerator, Type& out_denominator) {
     CurvePoint<Type> result;
-    auto[Px,Pz,a24,s,a,u,v,vmu,v3u,u3,v4u3,c5] = modArithm::createContext(curve.mod, result.x, result.z, curve.a24, sigma, curve.tmp[0], curve.tmp[1], curve.tmp[2], curve.tmp[3], curve.tmp[4], curve.tmp[5], curve.tmp[6], curve.tmp[7]);
-    
+    auto[Px,Pz,s,numerator,denominator,u,v,vmu,v3u,u3,c5] = modArithm::createContext(curve.mod, result.x, result.z, sigma, out_numerator, out_denominator, curve.tmp[0], curve.tmp[1], curve.tmp[2], curve.tmp[3], curve.tmp[4], curve.tmp[5]);
+
     c5 = getConstant(5, curve.mod);;
     u = sqr(s) - c5;                        // u = sigma^2 - 5
     v = dbl(dbl(s));                        // v = 4*sigma
     vmu = v - u;                            // v - u
     v3u = dbl(u) + u + v;                   // 3u + v
     u3 = sqr(u) * u;                        // u^3
-    v4u3 = inv(dbl(dbl(u3)) * v);           // 1 / (4u^3 * v)
-    a = ((sqr(vmu) * vmu + v3u) * v4u3);    // a = ((v-u)^3 * (3u+v)) / (4u^3 * v)
-    a24 = a;
-    a24 >>= 2;
+    denominator = dbl(dbl(dbl(dbl(u3)))) * v; // 16u^3 * v
+    numerator = sqr(vmu) * vmu * v3u;       // a24 = (A+2)/4 = ((v-u)^3 * (3u+v)) / (16u^3 * v)
     Px = u3;                                // x = u^3
     Pz = sqr(v) * v;                        // z = v^3
 
     return result;
 }
+template<typename Type, typename ModType> void montgomerySetCurveParameter(EllipticCurve<Type, ModType>& curve, const Type& numerator, const Type& denominatorInverse) {
+    auto[a24,n,dInv] = modArithm::createContext(curve.mod, curve.a24, numerator, denominatorInverse);
+    a24 = n * dInv;
+}
+template<typename Type, typename ModType> CurvePoint<Type> MontgomeryGenerateCurvePoint(EllipticCurve<Type, ModType>& curve, const Type& sigma) {
+    Type numerator, denominator;
+    auto result = montgomeryGenerateCurvePointFraction(curve, sigma, numerator, denominator);
+    modInv(denominator, denominator, curve.mod);
+    montgomerySetCurveParameter(curve, numerator, denominator);
+    return result;
+}
+// generates out_curves.size() next curves with a single inversion, returns false (and leaves the curve unchanged)
+// if the product of their denominators is not invertible
+template<typename Type, typename ModType> bool montgomeryGenerateCurvesAndPoints(EllipticCurve<Type, ModType>& curve, std::span<EllipticCurve<Type, ModType>> out_curves, std::span<CurvePoint<Type>> out_points) {
+    auto count = out_curves.size();
+    std::vector<Type> numerators(count), denominators(count), products(count);
+    Type sigma = curve.sigma;
+    for (std::size_t i = 0; i < count; ++i) {
+        add(curve.sigma, curve.sigma, getConstant(1, curve.mod));
+        out_points[i] = montgomeryGenerateCurvePointFraction(curve, curve.sigma, numerators[i], denominators[i]);
+        out_curves[i] = curve;
+    }
+    if (batchModInv(std::span<Type>(denominators), std::span<Type>(products), curve.mod) != Type{ 1 }) {
+        curve.sigma = sigma;
+        return false;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        montgomerySetCurveParameter(out_curves[i], numerators[i], denominators[i]);
+    }
+    curve = out_curves[count - 1];
+    return true;
+}
@@ -6,7 +6,7 @@
 #include <array>
 
 // 12M + 2S + 7D
-template<typename Type, typename ModType> void _shortWeierstrassAddsub(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q, bool isAdd) {
+template<typename Curve, typename Type> void _shortWeierstrassAddsub(Curve& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q, bool isAdd) {
     auto [Px, Py, Pz, Qx, Qy, Qz, u0, u1, u2, u3, u4] = modArithm::createContext(
         curve.mod, p.x, p.y, p.z, q.x, q.y, q.z, curve.tmp[0], curve.tmp[1], curve.tmp[2], curve.tmp[3], curve.tmp[4]
     );
@@ -29,15 +29,15 @@ template<typename Type, typename ModType> void _shortWeierstrassAddsub(EllipticC
     Py = ((Py - Pz) * u3) - u1;
     Pz = u0 * u2;
 }
-template<typename Type, typename ModType> void shortWeierstrassAdd(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q) {
+template<typename Curve, typename Type> void shortWeierstrassAdd(Curve& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q) {
     _shortWeierstrassAddsub(curve, p, q, true);
 }
-template<typename Type, typename ModType> void shortWeierstrassSub(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q) {
+template<typename Curve, typename Type> void shortWeierstrassSub(Curve& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q) {
     _shortWeierstrassAddsub(curve, p, q, false);
 }
 
 // 6M + 6S + 12D
-template<typename Type, typename ModType> void shortWeierstrassDbl(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p) {
+template<typename Curve, typename Type> void shortWeierstrassDbl(Curve& curve, CurvePoint<Type>& p) {
     auto [a, Px, Py, Pz, u0, u1, u2, u3, u4] = modArithm::createContext(
         curve.mod, curve.a, p.x, p.y, p.z, curve.tmp[0], curve.tmp[1], curve.tmp[2], curve.tmp[3], curve.tmp[4]
     );
@@ -56,7 +56,7 @@ template<typename Type, typename ModType> void shortWeierstrassDbl(EllipticCurve
 
 
 template<typename Type, typename ModType> void mulShortWeierstrassProjective(const ModType& m, const Type& a, CurvePoint<Type>& p, uint64_t n) {
-    static EllipticCurve<Type, ModType> tmpCurve(EllipticCurveForm::ShortWeierstrass);
+    thread_local EllipticCurve<Type, ModType> tmpCurve(EllipticCurveForm::ShortWeierstrass);
     tmpCurve.mod = m;
     tmpCurve.a = a;
     mul(tmpCurve, p, n);
@@ -5,15 +5,30 @@
 #include "shortWeierstrass.h"
 #include <tuple>
 #include <array>
+#include <vector>
+#include <span>
 #include <unordered_map>
 
+// costs in multiplications: 4M + 4S doubling, 8M addition and 7M mixed addition (of a point with Z=1)
+constexpr int TwistedEdwardsDblCost = 8;
+constexpr int TwistedEdwardsAddCost = 8;
+constexpr int TwistedEdwardsMixedAddCost = 7;
+// normalizing n points to Z=1 takes about 6n multiplications and one inversion (~100M together with its gcd check)
+constexpr int TwistedEdwardsNormalizeCost = 6;
+constexpr int TwistedEdwardsInversionCost = 100;
+
+// table of tableSize points is worth normalizing if its points are added addCount times afterwards
+bool twistedEdwardsUseAffineTable(int tableSize, int addCount) {
+    auto saving = addCount * (TwistedEdwardsAddCost - TwistedEdwardsMixedAddCost);
+    return saving > tableSize * TwistedEdwardsNormalizeCost + TwistedEdwardsInversionCost;
+}
 
 // Input  = Extended
 // Output =
 // Extended:     8M + 0S + 10D
 // Projective:   7M + 0S + 10D
 // MontgomeryXY: 4M + 0S + 12D
-template<typename Type, typename ModType> void _twistedEdwardsAddsub(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q, CoordinateSystem outputSystem = CoordinateSystem::Extended, bool isAdd = true) {
+template<typename Curve, typename Type> void _twistedEdwardsAddsub(Curve& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q, CoordinateSystem outputSystem = CoordinateSystem::Extended, bool isAdd = true) {
     debugAssert(outputSystem == CoordinateSystem::Extended || outputSystem == CoordinateSystem::Projective || outputSystem == CoordinateSystem::MontgomeryXY, "Unsupported output coordinate system");
     auto [Px, Py, Pz, Pt, Qx, Qy, Qz, Qt, u0, u1, u2] = modArithm::createContext(
         curve.mod, p.x, p.y, p.z, p.t, q.x, q.y, q.z, q.t, curve.tmp[0], curve.tmp[1], curve.tmp[2]
@@ -64,20 +79,91 @@ template<typename Type, typename ModType> void _twistedEdwardsAddsub(EllipticCur
         Px = Px + u0;
     }
 }
-template<typename Type, typename ModType> void twistedEdwardsAdd(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q) {
+template<typename Curve, typename Type> void twistedEdwardsAdd(Curve& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q) {
     _twistedEdwardsAddsub(curve, p, q, CoordinateSystem::Extended, true);
 }
-template<typename Type, typename ModType> void twistedEdwardsSub(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q) {
+template<typename Curve, typename Type> void twistedEdwardsSub(Curve& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q) {
     _twistedEdwardsAddsub(curve, p, q, CoordinateSystem::Extended, false);
 }
 
+// Input  = Extended, q in cached affine form (see twistedEdwardsToCachedAffine)
+// Output =
+// Extended:   7M + 0S + 7D
+// Projective: 6M + 0S + 7D
+template<typename Curve, typename Type> void _twistedEdwardsMixedAddsub(Curve& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q, CoordinateSystem outputSystem = CoordinateSystem::Extended, bool isAdd = true) {
+    debugAssert(outputSystem == CoordinateSystem::Extended || outputSystem == CoordinateSystem::Projective, "Unsupported output coordinate system");
+    auto [Px, Py, Pz, Pt, Qx, Qy, Qt, u0, u1, u2] = modArithm::createContext(
+        curve.mod, p.x, p.y, p.z, p.t, q.x, q.y, q.t, curve.tmp[0], curve.tmp[1], curve.tmp[2]
+    );
+
+    // Qx = y - x, Qy = y + x
+    u2 = Py - Px;
+    if (isAdd) {
+        u0 = Qy * u2;
+    } else {
+        u0 = Qx * u2;
+    }
+    u2 = Py + Px;
+    if (isAdd) {
+        u1 = Qx * u2;
+    } else {
+        u1 = Qy * u2;
+    }
+    Px = u1 - u0;
+    Py = u1 + u0;
+
+    u1 = Pz * Qt;
+    u2 = Pt + Pt;
+    if (isAdd) {
+        u0 = u2 - u1;
+        u1 = u1 + u2;
+    } else {
+        u0 = u2 + u1;
+        u2 = u2 - u1;
+        u1 = u2;
+    }
+    Pz = Px * Py;
+    Px = Px * u1;
+    Py = Py * u0;
+    if (outputSystem == CoordinateSystem::Extended) {
+        Pt = u0 * u1;
+    }
+}
+
+// Converts points from extended coordinates to the cached affine form used by mixed additions:
+// x = (Y - X)/Z, y = (Y + X)/Z, t = 2T/Z (z is not used), with one modular inversion for all points.
+// Returns false and leaves the points unchanged if some Z is not invertible.
+template<typename Curve, typename Type> bool twistedEdwardsToCachedAffine(Curve& curve, std::span<CurvePoint<Type>> points) {
+    thread_local std::vector<Type> zInverses;
+    thread_local std::vector<Type> products;
+    zInverses.resize(points.size());
+    products.resize(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        zInverses[i] = points[i].z;
+    }
+    if (batchModInv(std::span(zInverses), std::span(products), curve.mod) != Type{ 1 }) {
+        return false;
+    }
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        auto [X, Y, T, zInv, u0, u1] = modArithm::createContext(
+            curve.mod, points[i].x, points[i].y, points[i].t, zInverses[i], curve.tmp[0], curve.tmp[1]
+        );
+        u0 = X * zInv;
+        u1 = Y * zInv;
+        T = u0 * u1;
+        T = T + T;
+        X = u1 - u0;
+        Y = u1 + u0;
+    }
+    return true;
+}
+
 
 // Input  = Extended || Projective
 // Output =
 // Extended:   4M + 4S + 6D
 // Projective: 3M + 4S + 6D
-template<typename Type, typename ModType> void twistedEdwardsDbl(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p) {
-    CoordinateSystem outputSystem = CoordinateSystem::Extended;
+template<typename Curve, typename Type> void twistedEdwardsDbl(Curve& curve, CurvePoint<Type>& p, CoordinateSystem outputSystem = CoordinateSystem::Extended) {
     debugAssert(outputSystem == CoordinateSystem::Extended || outputSystem == CoordinateSystem::Projective, "Unsupported output coordinate system");
     auto [X, Y, Z, T, u, v, xxx] = modArithm::createContext(curve.mod, p.x, p.y, p.z, p.t, curve.tmp[0], curve.tmp[1], curve.tmp[2]);
     
@@ -101,8 +187,7 @@ template<typename Type, typename ModType> void twistedEdwardsDbl(EllipticCurve<T
 // Output =
 // Extended:   11M + 3S + 10D
 // Projective:  9M + 3S + 10D
-template<typename Type, typename ModType> void twistedEdwardsTpl(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p) {
-    CoordinateSystem outputSystem = CoordinateSystem::Extended;
+template<typename Curve, typename Type> void twistedEdwardsTpl(Curve& curve, CurvePoint<Type>& p, CoordinateSystem outputSystem = CoordinateSystem::Extended) {
     debugAssert(outputSystem == CoordinateSystem::Extended || outputSystem == CoordinateSystem::Projective, "Unsupported output coordinate system");
     auto [X, Y, Z, T, a, b, c, d] = modArithm::createContext(curve.mod, p.x, p.y, p.z, p.t, curve.tmp[0], curve.tmp[1], curve.tmp[2], curve.tmp[3]);
 
@@ -143,7 +228,7 @@ template<typename Type, typename ModType> CurvePoint<Type> twistedEdwardsGenerat
     debugAssert(outputSystem == CoordinateSystem::Extended || outputSystem == CoordinateSystem::Projective || outputSystem == CoordinateSystem::MontgomeryXY, "Unsupported output coordinate system");
     debugAssert(k != 0);
     
-    static std::array<Type, 12> t_; // TODO: what if multithreaded?
+    thread_local std::array<Type, 12> t_;
     CurvePoint<Type> result;
     CurvePoint<Type> T;
     auto[Px,Py,Pz,Pt,Tx,Ty,Tz,Tt,U,V,W,u0,u1,u2,u3,u4,u5,u6,u7,u8] = modArithm::createContext(curve.mod, 
@@ -151,7 +236,7 @@ template<typename Type, typename ModType> CurvePoint<Type> twistedEdwardsGenerat
     );
 
     std::array<Type, 8>* constants;
-    static std::unordered_map<ModType, std::array<Type, 8>> precomputedConstantsPerMod; // TODO: what if multithreaded?
+    thread_local std::unordered_map<ModType, std::array<Type, 8>> precomputedConstantsPerMod;
     auto mapConstants = precomputedConstantsPerMod.find(curve.mod);
     if (mapConstants != precomputedConstantsPerMod.end()) {
         constants = &mapConstants->second;
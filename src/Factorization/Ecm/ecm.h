@@ -4,93 +4,365 @@
 #include "curves/EllipticCurve.h"
 #include "common.h"
 #include "cascadeMultiplication.h"
+#include "stage1Program.h"
+#include "../stage2.h"
+#include "../../Utility/threadPool.h"
 #include <cstdint>
 #include <cstdlib>
 #include <numeric>
 #include <cmath>
 #include <vector>
+#include <span>
+#include <mutex>
+#include <atomic>
 
 template<typename Type, typename ModType> void mul(EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, uint64_t n) {
     EcmContext context;
     doubleAndAddMul(context, curve, p, n);
 }
 
-template<typename ValueType, typename ModType> ValueType ecm_(EcmContext& context, EllipticCurve<ValueType, ModType>& curve) {
-    using T = ValueType;
+// number of giant steps normalized with one inversion
+constexpr uint64_t EcmStage2GiantBatchSize = 256;
+// number of curves generated with one inversion when curves run one at a time
+constexpr uint64_t EcmCurveGenerationBatchSize = 16;
 
-    T factor = T{ 1 };
-    T zero = T{ 0 };
-    T one = T{ 1 };
-    auto modValue = getModValue(curve.mod);
+// Baby steps jP and giant steps gDP share a coordinate (y for Edwards curves, x otherwise) exactly when gDP = +-jP,
+// so a multiplication by (coordinate(gDP) - coordinate(jP)) covers both gD - j and gD + j.
+// Pairs are found once and shared by all curves.
+struct EcmStage2Plan : Stage2Plan {
+    std::vector<uint64_t> pairMasks; // maskWords words for every giant step
+};
 
-    if (context.initialCurveSeed == MaxU64) {
-        context.initialCurveSeed = curve.defaultSeed();
+EcmStage2Plan ecmStage2Plan(const EcmContext& context) {
+    EcmStage2Plan plan;
+    static_cast<Stage2Plan&>(plan) = createStage2Plan(context.B1, context.B2);
+    plan.pairMasks.resize(plan.giantCount * plan.maskWords);
+    forEachStage2Giant(plan, [&](uint64_t giantIndex, const uint64_t* mask) {
+        std::copy(mask, mask + plan.maskWords, &plan.pairMasks[giantIndex * plan.maskWords]);
+        return true;
+    });
+    return plan;
+}
+
+// Divides values[i] by zs[i] for i < count using a single inversion (batchModInv, zs are replaced with their inverses).
+// If product of zs is not invertible, returns its gcd with n (and leaves values unchanged), otherwise returns 1.
+template<typename ValueType, typename ModType> ValueType ecmNormalize_(std::vector<ValueType>& values, std::vector<ValueType>& zs, std::size_t count, std::vector<ValueType>& products, const ModType& mod) {
+    auto factor = batchModInv(std::span(zs.data(), count), std::span(products.data(), count), mod);
+    if (factor != ValueType{ 1 }) {
+        return factor;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        modMul(values[i], values[i], zs[i], mod);
     }
-    CurvePoint<T> point = curve.initializeCurveAndPoint(context.initialCurveSeed);
-    auto [stage1Bytecode, i] = createBytecode(context, curve.form, curve.mod);
+    return factor;
+}
 
-    for (std::size_t j = 0; j < context.curveCount; ++j) {
-        context.out_curveDoneCount += 1;
+template<typename ValueType, typename ModType> ValueType ecmStage1Factor_(EllipticCurve<ValueType, ModType>& curve, const CurvePoint<ValueType>& point) {
+    ValueType factor = ValueType{ 1 };
+    if (point.z != ValueType{ 0 }) {
+        gcd(factor, point.z, curve.mod);
+    }
+    return factor;
+}
 
-        // Stage 1
-        runBytecode(stage1Bytecode, curve, point);
-        if (point.z != zero) {
-            gcd(factor, point.z, curve.mod);
+template<typename ValueType, typename ModType> ValueType ecmStage1_(EllipticCurve<ValueType, ModType>& curve, CurvePoint<ValueType>& point, const Stage1Program& stage1Program) {
+    runStage1Program(stage1Program, curve, point);
+    return ecmStage1Factor_(curve, point);
+}
+
+// PRAC chains exist only for odd primes, so with PRAC composite multipliers are done prime by prime
+template<typename ValueType, typename ModType> void ecmStage2Mul_(EcmContext& context, EllipticCurve<ValueType, ModType>& curve, CurvePoint<ValueType>& point, uint64_t k) {
+    if (context.mulMethod != EcmMulMethod::Prac) {
+        cascadeMulDoMultiplication(context, curve, point, k);
+        return;
+    }
+    auto mulPrime = [&](uint64_t p) {
+        if (p == 2) {
+            dbl(curve, point);
+        } else {
+            cascadeMulDoMultiplication(context, curve, point, p);
         }
-        if (factor != one) {
-            return factor;
+    };
+    for (uint64_t p = 2; p * p <= k; ++p) {
+        while (k % p == 0) {
+            mulPrime(p);
+            k /= p;
         }
+    }
+    if (k > 1) {
+        mulPrime(k);
+    }
+}
 
-        // Stage 2
-        if (context.B2 > context.B1) {
-            uint64_t firstPrime = Primes_1_000_000[i];
-            uint64_t prevPrime = firstPrime;
-            i += 1;
-            std::vector<int> primeDifferencesBetweenB1B2;
-            for (; Primes_1_000_000[i] <= context.B2; ++i) {
-                primeDifferencesBetweenB1B2.emplace_back(Primes_1_000_000[i] - prevPrime);
-                prevPrime = Primes_1_000_000[i];
+template<typename ValueType, typename ModType> ValueType ecmStage2_(EcmContext& context, EllipticCurve<ValueType, ModType>& curve, CurvePoint<ValueType>& point, const EcmStage2Plan& plan) {
+    using T = ValueType;
+
+    T factor = T{ 1 };
+    if (plan.giantCount == 0) {
+        return factor;
+    }
+    // whole n is not a useful factor
+    auto finish = [&](const T& result) {
+        return result == getModValue(curve.mod) ? T{ 1 } : result;
+    };
+    bool isDifferential = curve.form == EllipticCurveForm::Montgomery;
+    auto coordinate = [&](CurvePoint<T>& p) -> T& {
+        return curve.form == EllipticCurveForm::TwistedEdwards ? p.y : p.x;
+    };
+
+    // baby steps: (j+2)P = jP + 2P for odd j
+    auto babyCount = plan.babySteps.size();
+    std::vector<T> babyValues(babyCount);
+    std::vector<T> babyZs(babyCount);
+    std::vector<T> products(std::max<std::size_t>(babyCount, EcmStage2GiantBatchSize));
+    CurvePoint<T> babyStep = point;
+    dbl(curve, babyStep);
+    CurvePoint<T> baby = point;
+    CurvePoint<T> previousBaby = point;
+    CurvePoint<T> nextBaby;
+    int j = 1;
+    for (std::size_t b = 0; b < babyCount; j += 2) {
+        if (j > 1) {
+            if (isDifferential) {
+                diffAdd(curve, nextBaby, baby, babyStep, previousBaby);
+                std::swap(previousBaby, baby);
+                std::swap(baby, nextBaby);
+            } else {
+                add(curve, baby, babyStep);
             }
-            int maxDiff = *std::max_element(primeDifferencesBetweenB1B2.begin(), primeDifferencesBetweenB1B2.end());
-            std::vector<CurvePoint<T>> diffTable(maxDiff / 2);
-            diffTable[0] = point;
-            dbl(curve, diffTable[0]);
-            diffTable[1] = diffTable[0];
-            dbl(curve, diffTable[1]);
-            for (int j = 2; j < maxDiff/2; ++j) {
-                diffTable[j] = diffTable[j - 1];
-                if (context.mulMethod == EcmMulMethod::Prac) {
-                    diffAdd(curve, diffTable[j], diffTable[j], diffTable[0], diffTable[j-1]);
-                } else {
-                    add(curve, diffTable[j], diffTable[0]);
-                }
+        }
+        if (j == plan.babySteps[b]) {
+            babyValues[b] = coordinate(baby);
+            babyZs[b] = baby.z;
+            b += 1;
+        }
+    }
+    factor = ecmNormalize_(babyValues, babyZs, babyCount, products, curve.mod);
+    if (factor != T{ 1 }) {
+        return finish(factor);
+    }
+
+    // giant steps: (g+1)DP = gDP + DP. First two are computed directly, so that no addition is a doubling in disguise
+    CurvePoint<T> giantStep = point;
+    ecmStage2Mul_(context, curve, giantStep, plan.D);
+    CurvePoint<T> giant = giantStep;
+    ecmStage2Mul_(context, curve, giant, plan.firstGiant);
+    CurvePoint<T> nextGiant = giantStep;
+    ecmStage2Mul_(context, curve, nextGiant, plan.firstGiant + 1);
+
+    auto batchSize = static_cast<std::size_t>(std::min<uint64_t>(plan.giantCount, EcmStage2GiantBatchSize));
+    std::vector<T> giantValues(batchSize);
+    std::vector<T> giantZs(batchSize);
+    T accumulator = getConstant(1, curve.mod);
+    T difference;
+    for (uint64_t batchBegin = 0; batchBegin < plan.giantCount; batchBegin += batchSize) {
+        auto count = static_cast<std::size_t>(std::min<uint64_t>(batchSize, plan.giantCount - batchBegin));
+        for (std::size_t i = 0; i < count; ++i) {
+            giantValues[i] = coordinate(giant);
+            giantZs[i] = giant.z;
+            if (isDifferential) {
+                diffAdd(curve, giant, nextGiant, giantStep, giant);
+                std::swap(giant, nextGiant);
+            } else {
+                giant = nextGiant;
+                add(curve, nextGiant, giantStep);
             }
+        }
+        factor = ecmNormalize_(giantValues, giantZs, count, products, curve.mod);
+        if (factor != T{ 1 }) {
+            return finish(factor);
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            forEachStage2Pair(plan, &plan.pairMasks[(batchBegin + i) * plan.maskWords], [&](int b) {
+                modSub(difference, giantValues[i], babyValues[b], curve.mod);
+                modMul(accumulator, accumulator, difference, curve.mod);
+            });
+        }
+    }
 
-            cascadeMulDoMultiplication(context, curve, point, firstPrime);
-            
-            T runningMult = point.z; // TODO: I'm not sure if how I'm calculating this is ok (just multiplying all point.z and gcd at end)
-            for (int diff : primeDifferencesBetweenB1B2) {
-                if (context.mulMethod == EcmMulMethod::Prac) {
-                    debugAssert(false);
-                    //diffAdd(curve, point, diffTable[diff / 2 - 1], point, );
-                } else {
-                    add(curve, point, diffTable[diff / 2 - 1]);
-                }
-                modMul(runningMult, runningMult, point.z, curve.mod);
+    if (accumulator != T{ 0 }) {
+        gcd(factor, accumulator, curve.mod);
+    }
+    return finish(factor);
+}
+
+// lane types used to run stage 1 of many curves at once (only fixed size Montgomery moduli are supported)
+template<typename ModType> struct EcmCurveLanes {
+    static constexpr bool IsSupported = false;
+};
+template<int S> struct EcmCurveLanes<MontgomeryReductionMod<BigIntFixedSize<S>>> {
+    static constexpr bool IsSupported = true;
+    static constexpr int Size = S;
+    static constexpr int LaneCount = BigIntLanesDefaultCount;
+    using ValueType = BigIntFixedSizeLanes<S, LaneCount>;
+    using ModType = MontgomeryReductionMod<ValueType>;
+};
+
+template<typename ValueType, typename ModType> void ecmPackCurveLane_(EllipticCurve<typename EcmCurveLanes<ModType>::ValueType, typename EcmCurveLanes<ModType>::ModType>& laneCurve, CurvePoint<typename EcmCurveLanes<ModType>::ValueType>& lanePoint, int lane, const EllipticCurve<ValueType, ModType>& curve, const CurvePoint<ValueType>& point) {
+    auto pack = [&](auto& laneValue, const ValueType& value) {
+        setLane(laneValue, lane, convertToValue(value, curve.mod), laneCurve.mod);
+    };
+    pack(lanePoint.x, point.x);
+    pack(lanePoint.y, point.y);
+    pack(lanePoint.z, point.z);
+    pack(lanePoint.t, point.t);
+    pack(laneCurve.a, curve.a);
+    pack(laneCurve.a24, curve.a24);
+}
+template<typename ValueType, typename ModType> void ecmUnpackCurveLane_(const EllipticCurve<typename EcmCurveLanes<ModType>::ValueType, typename EcmCurveLanes<ModType>::ModType>& laneCurve, const CurvePoint<typename EcmCurveLanes<ModType>::ValueType>& lanePoint, int lane, const EllipticCurve<ValueType, ModType>& curve, CurvePoint<ValueType>& point) {
+    auto unpack = [&](ValueType& value, const auto& laneValue) {
+        value = getConstant(getLane(laneValue, lane, laneCurve.mod), curve.mod);
+    };
+    unpack(point.x, lanePoint.x);
+    unpack(point.y, lanePoint.y);
+    unpack(point.z, lanePoint.z);
+    unpack(point.t, lanePoint.t);
+}
+
+// Runs curves [curveBegin, curveEnd) in groups of LaneCount: stage 1 of the whole group is done at once
+// with every curve in its own SIMD lane, gcd and stage 2 are done for each curve separately.
+template<typename ValueType, typename ModType> ValueType ecmCurveRangeLanes_(EcmContext& context, EllipticCurve<ValueType, ModType>& curve, uint64_t curveBegin, uint64_t curveEnd, const Stage1Program& stage1Program, const EcmStage2Plan& stage2Plan, const std::atomic<bool>& stop) {
+    using T = ValueType;
+    using Lanes = EcmCurveLanes<ModType>;
+    constexpr int LaneCount = Lanes::LaneCount;
+
+    EllipticCurve<typename Lanes::ValueType, typename Lanes::ModType> laneCurve(curve.form);
+    laneCurve.mod = getMontgomeryReductionMod<Lanes::Size, LaneCount>(getModValue(curve.mod));
+    // the last element is the first curve of the next group
+    std::vector<EllipticCurve<T, ModType>> curves(LaneCount + 1, curve);
+    std::vector<CurvePoint<T>> points(LaneCount + 1);
+
+    CurvePoint<T> point = curve.initializeCurveAndPoint(context.initialCurveSeed, curveBegin);
+    for (uint64_t groupBegin = curveBegin; groupBegin < curveEnd && !stop; groupBegin += LaneCount) {
+        int curveCount = static_cast<int>(std::min<uint64_t>(LaneCount, curveEnd - groupBegin));
+        curves[0] = curve;
+        points[0] = point;
+        auto generatedCount = std::min<uint64_t>(LaneCount, curveEnd - groupBegin - 1);
+        if (generatedCount > 0) {
+            curve.generateNewCurvesAndPoints(std::span(curves).subspan(1, generatedCount), std::span(points).subspan(1, generatedCount));
+            point = points[generatedCount];
+        }
+
+        // unused lanes of the last group repeat the first curve
+        CurvePoint<typename Lanes::ValueType> lanePoint;
+        for (int lane = 0; lane < LaneCount; ++lane) {
+            int source = lane < curveCount ? lane : 0;
+            ecmPackCurveLane_(laneCurve, lanePoint, lane, curves[source], points[source]);
+        }
+        runStage1Program(stage1Program, laneCurve, lanePoint);
+
+        for (int lane = 0; lane < curveCount; ++lane) {
+            context.out_curveDoneCount += 1;
+            ecmUnpackCurveLane_(laneCurve, lanePoint, lane, curves[lane], points[lane]);
+            auto factor = ecmStage1Factor_(curves[lane], points[lane]);
+            if (factor == T{ 1 } && !stop) {
+                factor = ecmStage2_(context, curves[lane], points[lane], stage2Plan);
             }
-            if (runningMult != zero)
-                gcd(factor, runningMult, curve.mod);
-            if (factor != one && factor != modValue) {
+            if (factor != T{ 1 }) {
                 return factor;
             }
         }
+    }
+    return T{ 1 };
+}
+
+// Runs curves [curveBegin, curveEnd) on the calling thread until a factor is found or 'stop' is set.
+template<typename ValueType, typename ModType> ValueType ecmCurveRange_(EcmContext& context, EllipticCurve<ValueType, ModType>& curve, uint64_t curveBegin, uint64_t curveEnd, const Stage1Program& stage1Program, const EcmStage2Plan& stage2Plan, const std::atomic<bool>& stop) {
+    using T = ValueType;
+
+    if constexpr (EcmCurveLanes<ModType>::IsSupported) {
+        if (context.vectorizeCurves && curveEnd - curveBegin > 1) {
+            return ecmCurveRangeLanes_(context, curve, curveBegin, curveEnd, stage1Program, stage2Plan, stop);
+        }
+    }
+
+    // next curves are generated in batches of EcmCurveGenerationBatchSize
+    std::vector<EllipticCurve<T, ModType>> nextCurves(EcmCurveGenerationBatchSize, curve);
+    std::vector<CurvePoint<T>> nextPoints(EcmCurveGenerationBatchSize);
+    std::size_t nextIndex = 0;
+    std::size_t nextCount = 0;
+
+    CurvePoint<T> point = curve.initializeCurveAndPoint(context.initialCurveSeed, curveBegin);
+    for (uint64_t j = curveBegin; j < curveEnd && !stop; ++j) {
+        context.out_curveDoneCount += 1;
+        auto factor = ecmStage1_(curve, point, stage1Program);
+        if (factor == T{ 1 } && !stop) {
+            factor = ecmStage2_(context, curve, point, stage2Plan);
+        }
+        if (factor != T{ 1 }) {
+            return factor;
+        }
+        if (j + 1 < curveEnd) {
+            if (nextIndex == nextCount) {
+                nextCount = static_cast<std::size_t>(std::min<uint64_t>(EcmCurveGenerationBatchSize, curveEnd - j - 1));
+                nextIndex = 0;
+                curve.generateNewCurvesAndPoints(std::span(nextCurves).first(nextCount), std::span(nextPoints).first(nextCount));
+            }
+            curve = nextCurves[nextIndex];
+            point = nextPoints[nextIndex];
+            nextIndex += 1;
+        }
+    }
+    return T{ 1 };
+}
 
-        curve.generateNewCurveAndPoint(point);
+template<typename ValueType, typename ModType> ValueType ecmParallel_(EcmContext& context, const EllipticCurve<ValueType, ModType>& curve, const Stage1Program& stage1Program, const EcmStage2Plan& stage2Plan) {
+    using T = ValueType;
+
+    T factor = T{ 1 };
+    std::mutex factorMutex;
+    std::atomic<bool> factorFound = false;
+
+    auto& pool = globalThreadPool();
+    int workerCount = static_cast<int>(std::min<uint64_t>(std::min(context.threadCount, pool.concurrency()), context.curveCount));
+    std::vector<EcmContext> workerContexts(workerCount, context);
+    TaskGroup group;
+    for (int w = 0; w < workerCount; ++w) {
+        // every worker gets its own copy of the curve (with its own modular arithmetic temporaries)
+        // and a disjoint range of curve seeds
+        pool.run(group, [&, w] {
+            auto& workerContext = workerContexts[w];
+            workerContext.out_dblCount = 0;
+            workerContext.out_addCount = 0;
+            workerContext.out_curveDoneCount = 0;
+            uint64_t curveBegin = context.curveCount * w / workerCount;
+            uint64_t curveEnd = context.curveCount * (w + 1) / workerCount;
+
+            auto workerCurve = curve;
+            auto curveFactor = ecmCurveRange_(workerContext, workerCurve, curveBegin, curveEnd, stage1Program, stage2Plan, factorFound);
+            if (curveFactor != T{ 1 }) {
+                std::lock_guard<std::mutex> lock(factorMutex);
+                if (!factorFound) {
+                    factor = curveFactor;
+                    factorFound = true;
+                }
+            }
+        });
     }
+    pool.wait(group);
 
+    for (auto& workerContext : workerContexts) {
+        context.out_dblCount += workerContext.out_dblCount;
+        context.out_addCount += workerContext.out_addCount;
+        context.out_curveDoneCount += workerContext.out_curveDoneCount;
+    }
     return factor;
 }
 
+template<typename ValueType, typename ModType> ValueType ecm_(EcmContext& context, EllipticCurve<ValueType, ModType>& curve) {
+    if (context.initialCurveSeed == MaxU64) {
+        context.initialCurveSeed = curve.defaultSeed();
+    }
+    auto stage1Program = compileStage1Bytecode(createBytecode(context, curve.form).first);
+    auto stage2Plan = ecmStage2Plan(context);
+
+    if (context.threadCount > 1 && context.curveCount > 1) {
+        return ecmParallel_(context, curve, stage1Program, stage2Plan);
+    }
+    std::atomic<bool> stop = false;
+    return ecmCurveRange_(context, curve, 0, context.curveCount, stage1Program, stage2Plan, stop);
+}
+
 template<typename ModType> BigIntValueType<ModType> ecm(EcmContext& context, const ModType& mod) {
     EllipticCurve<BigIntValueType<ModType>, ModType> curve;
     curve.mod = mod;
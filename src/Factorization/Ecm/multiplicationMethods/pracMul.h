@@ -5,16 +5,30 @@
 #include "../curves/montgomery.h"
 #include <cstdint>
 #include <algorithm>
+#include <numeric>
 
 constexpr auto MontgomeryAddCost = 6.0 /* number of multiplications in an addition */;
 constexpr auto MontgomeryDblCost = 5.0 /* number of multiplications in a duplicate */;
 
+/* 1/val[0] = the golden ratio (1+sqrt(5))/2, and 1/val[i] for i>0
+   is the real number whose continued fraction expansion is all 1s
+   except for a 2 in i+1-st place */
+constexpr int PracRatioCount = 10;
+constexpr double PracRatios[PracRatioCount] = {
+    0.61803398874989485, 0.72360679774997897, 0.58017872829546410,
+    0.63283980608870629, 0.61242994950949500, 0.62018198080741576,
+    0.61721461653440386, 0.61834711965622806, 0.61791440652881789,
+    0.61807966846989581
+};
+
+/* gcd(d, e) = gcd(n, r) stays the same during the whole chain, which ends with d = e = gcd(n, r),
+   so the chain computes nP only if r is coprime to n (for composite n, like 9 with r = 6, it is not) */
 double lucasCost(uint64_t n, double v) {
     uint64_t d, e, r;
     double c; /* cost */
     d = n;
     r = (uint64_t)((double)d * v + 0.5);
-    if (r >= n)
+    if (r >= n || std::gcd(n, r) != 1)
         return (MontgomeryAddCost * (double)n);
     d = n - r;
     e = 2 * r - n;
@@ -63,41 +77,34 @@ double lucasCost(uint64_t n, double v) {
     return c;
 }
 
+/* r of the cheapest of the first chainsToCheck chains (n has to be odd and bigger than 2).
+   If none of them works for n, r closest above n * PracRatios[0] that is coprime to n is used */
+uint64_t pracChooseR(uint64_t n, uint64_t chainsToCheck) {
+    auto ratioCount = std::clamp<uint64_t>(chainsToCheck, 1, PracRatioCount);
+    double cmin = MontgomeryAddCost * (double)n;
+    uint64_t r = 0;
+    for (uint64_t i = 0; i < ratioCount; i++) {
+        double c = lucasCost(n, PracRatios[i]);
+        if (c < cmin) {
+            cmin = c;
+            r = (uint64_t)((double)n * PracRatios[i] + 0.5);
+        }
+    }
+    if (r == 0) {
+        /* n - 1 is always coprime to n */
+        for (r = (uint64_t)((double)n * PracRatios[0] + 0.5); std::gcd(n, r) != 1; r++);
+    }
+    return r;
+}
+
 template<typename Type, typename ModType> void prac(EcmContext& context, EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, uint64_t k) {
-    constexpr auto NV = 10;
     auto& tmp = curve.tmp[0];
 
-    /* 1/val[0] = the golden ratio (1+sqrt(5))/2, and 1/val[i] for i>0
-       is the real number whose continued fraction expansion is all 1s
-       except for a 2 in i+1-st place */
-    static double val[NV] = { 
-        0.61803398874989485, 0.72360679774997897, 0.58017872829546410,
-        0.63283980608870629, 0.61242994950949500, 0.62018198080741576,
-        0.61721461653440386, 0.61834711965622806, 0.61791440652881789,
-        0.61807966846989581 
-    };
-
     /* for small n, it makes no sense to try 10 different Lucas chains */
-    auto nv = std::min<uint64_t>(NV, sizeInLimbs(curve.mod));
-
-    uint64_t i = 0;
-    if (nv > 1) {
-        /* chooses the best value of v */
-        double cmin = MontgomeryAddCost * (double)k;
-        for (uint64_t d = 0; d < nv; d++) {
-            double c = lucasCost(k, val[d]);
-            if (c < cmin) {
-                cmin = c;
-                i = d;
-            }
-        }
-    }
-
-    auto d = k;
-    auto r = (uint64_t)((double)d * val[i] + 0.5);
+    auto r = pracChooseR(k, sizeInLimbs(curve.mod));
 
     /* first iteration always begins by Condition 3, then a swap */
-    d = k - r;
+    auto d = k - r;
     uint64_t e = 2 * r - k;
     auto& A = p;
     auto B = p;
@@ -193,29 +200,8 @@ template<typename Type, typename ModType> void prac(EcmContext& context, Ellipti
 
 
 void pracMul(bytecode::Writer& bc, uint64_t n, int maxChainsToCheck) {
-    constexpr auto NV = 10;
-    static double val[NV] = { 
-        0.61803398874989485, 0.72360679774997897, 0.58017872829546410,
-        0.63283980608870629, 0.61242994950949500, 0.62018198080741576,
-        0.61721461653440386, 0.61834711965622806, 0.61791440652881789,
-        0.61807966846989581 
-    };
-
-    auto nv = std::min<uint64_t>(NV, maxChainsToCheck);
-    uint64_t i = 0;
-    if (nv > 1) {
-        double cmin = MontgomeryAddCost * (double)n;
-        for (uint64_t d = 0; d < nv; d++) {
-            double c = lucasCost(n, val[d]);
-            if (c < cmin) {
-                cmin = c;
-                i = d;
-            }
-        }
-    }
-
     bc.pracSTART();
-    auto r = (uint64_t)((double)n * val[i] + 0.5);
+    auto r = pracChooseR(n, maxChainsToCheck);
     auto d = n - r;
     auto e = 2 * r - n;
     while (d != e) {
@@ -256,7 +242,7 @@ void pracMul(bytecode::Writer& bc, uint64_t n, int maxChainsToCheck) {
             bc.pracRule(9, isSwap);
         }
     }
-    //debugAssert(d == 1);
+    debugAssert(d == 1);
     bc.pracEND();
 }
 
@@ -150,6 +150,19 @@ int nafCost(const std::vector<int8_t>& naf, int dblCost, int addCost, int interm
     auto [dblCount, addCount] = nafDblAddCounts(naf);
     return (intermediateDblCost * (dblCount - addCount) + dblCost * addCount) + (intermediateAddCost * (addCount - 1) + addCost);
 }
+// cost of a wNAF multiplication in stage 1 bytecode on a twisted Edwards curve, where additions of table points are
+// mixed additions if the table is worth normalizing
+template<typename Naf> int twistedEdwardsNafCost(const Naf& naf) {
+    auto [dblCount, addCount] = nafDblAddCounts(naf);
+    int tableSize = (absoluteMaxNaf(naf) + 1) / 2;
+    int chainAddCount = addCount - (tableSize - 1);
+    int cost = TwistedEdwardsDblCost * dblCount + TwistedEdwardsAddCost * addCount;
+    if (twistedEdwardsUseAffineTable(tableSize, chainAddCount)) {
+        cost += TwistedEdwardsNormalizeCost * tableSize + TwistedEdwardsInversionCost;
+        cost -= (TwistedEdwardsAddCost - TwistedEdwardsMixedAddCost) * chainAddCount;
+    }
+    return cost;
+}
 
 template<typename Type, typename ModType> void nafMul(EcmContext& context, EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& p, uint64_t n) {
     if (n == 0) { p = curve.zero(); return; }
@@ -318,7 +331,7 @@ template<typename T> void wNafMul(bytecode::Writer& bc, const T& n, int w) {
 void dNafMul(bytecode::Writer& bc, uint64_t n, EllipticCurveForm curveForm) {
     int bestWNaf = 0;
     if (curveForm == EllipticCurveForm::TwistedEdwards) {
-        auto [bestW, nafForm] = getBestWNaf(n, [](auto& a) { return nafCost(a, 8, 8, 8, 8); });
+        auto [bestW, nafForm] = getBestWNaf(n, [](auto& a) { return twistedEdwardsNafCost(a); });
         bestWNaf = bestW;
     } else if (curveForm == EllipticCurveForm::ShortWeierstrass) {
         auto [bestW, nafForm] = getBestWNaf(n, [](auto& a) { return nafCost(a, 12, 14, 12, 14); });
@@ -337,7 +350,7 @@ void dNafMul(bytecode::Writer& bc, uint64_t n, EllipticCurveForm curveForm) {
 template<typename T> void dNafMul(bytecode::Writer& bc, const T& n, EllipticCurveForm curveForm) {
     int bestWNaf = 0;
     if (curveForm == EllipticCurveForm::TwistedEdwards) {
-        auto [bestW, nafForm] = getBestWNaf(n, [](auto& a) { return nafCost(a, 8, 8, 8, 8); });
+        auto [bestW, nafForm] = getBestWNaf(n, [](auto& a) { return twistedEdwardsNafCost(a); });
         bestWNaf = bestW;
     } else if (curveForm == EllipticCurveForm::ShortWeierstrass) {
         auto [bestW, nafForm] = getBestWNaf(n, [](auto& a) { return nafCost(a, 12, 14, 12, 14); });
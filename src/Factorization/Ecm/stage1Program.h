@@ -0,0 +1,378 @@
+#pragma once
+#include "bytecode.h"
+#include "cascadeMultiplication.h"
+#include "curves/EllipticCurve.h"
+#include "curves/curveForms.h"
+#include "../../Utility/debugAssert.h"
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <span>
+#include <algorithm>
+
+/*
+    Stage 1 bytecode decoded once into superinstructions, run by an interpreter specialized for the curve form
+    (on curve types of curveForms.h, no byte decoding and no dispatch on the curve form per point operation):
+    - Step: tplCount triplings, dblCount doublings, then addition or subtraction of a table point (or nothing),
+    - NafTable, DbChainTable: table of multiples of the point at the start of Naf and DbChain blocks,
+    - PracStart, PracRule (one rule repeated), PracEnd: PRAC chains on Montgomery curves.
+    Since the whole sequence is known, every tripling, doubling and addition of twisted Edwards curves whose result
+    only goes to the next tripling or doubling outputs projective coordinates (extended T coordinate is not computed,
+    1M less for dbl and add, 2M less for tpl). Resulting points are the same as with runBytecode.
+    Tables of twisted Edwards curves whose points are added often enough (twistedEdwardsUseAffineTable) are normalized
+    to Z=1 with one inversion, then their points are added with mixed additions (1M less).
+*/
+enum class Stage1OpCode : uint8_t {
+    NafTable,
+    DbChainTable,
+    Step,
+    PracStart,
+    PracRule,
+    PracEnd,
+};
+enum class Stage1AddType : uint8_t {
+    None,
+    Add,
+    Sub,
+};
+
+struct Stage1Instruction {
+    Stage1OpCode opCode;
+    uint8_t index = 0;      // Step: table point to add, NafTable and DbChainTable: table size, PracRule: rule
+    uint8_t startIndex = 0; // NafTable and DbChainTable: table point to start from, PracRule: swap before the rule
+    Stage1AddType addType = Stage1AddType::None;
+    CoordinateSystem mulOutput = CoordinateSystem::Extended; // output of the last tpl or dbl of Step
+    CoordinateSystem addOutput = CoordinateSystem::Extended;
+    uint32_t tplCount = 0;  // PracRule: repetition count
+    uint32_t dblCount = 0;
+    bool isAffineTable = false; // NafTable and DbChainTable: table is normalized for mixed additions (twisted Edwards)
+};
+
+struct Stage1Program {
+    std::vector<Stage1Instruction> instructions;
+};
+
+// Step with the doubling/addition appended, if the last instruction is a Step that does not add yet it is extended
+void stage1AppendNafOp(std::vector<Stage1Instruction>& instructions, Stage1AddType addType, uint8_t index) {
+    if (instructions.back().opCode != Stage1OpCode::Step || instructions.back().addType != Stage1AddType::None) {
+        instructions.push_back({ Stage1OpCode::Step });
+    }
+    auto& step = instructions.back();
+    if (addType == Stage1AddType::None) {
+        step.dblCount += 1;
+    } else {
+        step.addType = addType;
+        step.index = index;
+    }
+}
+
+int stage1TableSize(const Stage1Instruction& table) {
+    return table.opCode == Stage1OpCode::NafTable ? std::max<int>(table.index, 1) : table.index + 1;
+}
+
+Stage1Program compileStage1Bytecode(const std::vector<uint8_t>& bytes) {
+    Stage1Program program;
+    auto& instructions = program.instructions;
+    bytecode::Reader bc(bytes);
+    bool isEnd = false;
+    while (!isEnd) {
+        switch (bc.peekNextBlockOpCode()) {
+        case bytecode::Block::Naf: {
+            Stage1Instruction table{ Stage1OpCode::NafTable };
+            table.index = bc.peekDataBits();
+            if (table.index > 1) {
+                bc.skipByte();
+                table.startIndex = bc.peekByte();
+            }
+            instructions.push_back(table);
+            bool isBlockEnd = false;
+            while (!isBlockEnd) {
+                bc.skipByte();
+                switch (bc.peekNafOpCode()) {
+                case bytecode::NafOpCode::ADD:
+                case bytecode::NafOpCode::ADDn: stage1AppendNafOp(instructions, Stage1AddType::Add, bc.peekDataBits()); break;
+                case bytecode::NafOpCode::SUB:
+                case bytecode::NafOpCode::SUBn: stage1AppendNafOp(instructions, Stage1AddType::Sub, bc.peekDataBits()); break;
+                case bytecode::NafOpCode::DBL:
+                case bytecode::NafOpCode::DBLn: stage1AppendNafOp(instructions, Stage1AddType::None, 0);                 break;
+                case bytecode::NafOpCode::END:
+                    bc.skipByte();
+                    isBlockEnd = true;
+                    break;
+                case bytecode::NafOpCode::FullMask:
+                    isBlockEnd = true;
+                    break;
+                }
+            }
+            break;
+        }
+        case bytecode::Block::DbChain: {
+            Stage1Instruction table{ Stage1OpCode::DbChainTable };
+            table.index = bc.peekDataBits();
+            if (table.index > 0) {
+                bc.skipByte();
+                table.startIndex = bc.peekByte();
+            }
+            instructions.push_back(table);
+            bc.skipByte();
+            while (true) {
+                auto inst = bc.nextInstruction();
+                Stage1Instruction step{ Stage1OpCode::Step };
+                step.tplCount = inst.tplCount;
+                step.dblCount = inst.dblCount;
+                if (!inst.skipAdd) {
+                    step.addType = inst.isSub ? Stage1AddType::Sub : Stage1AddType::Add;
+                    step.index = inst.index;
+                }
+                instructions.push_back(step);
+                if (inst.isFinal) {
+                    break;
+                }
+            }
+            break;
+        }
+        case bytecode::Block::Prac:
+            instructions.push_back({ Stage1OpCode::PracStart });
+            while (true) {
+                bc.skipByte();
+                if (bc.peekPracOpCode() == bytecode::PracOpCode::End) {
+                    break;
+                }
+                Stage1Instruction rule{ Stage1OpCode::PracRule };
+                rule.index = static_cast<uint8_t>(bc.peekPracOpCode());
+                rule.startIndex = bc.peekIfPracSwap();
+                rule.tplCount = bc.peekRepCount();
+                instructions.push_back(rule);
+            }
+            bc.skipByte();
+            instructions.push_back({ Stage1OpCode::PracEnd });
+            break;
+        case bytecode::Block::End:
+            isEnd = true;
+            break;
+        }
+    }
+
+    // results going only to the next tpl or dbl don't need extended coordinates
+    for (std::size_t i = 0; i < instructions.size(); ++i) {
+        auto& inst = instructions[i];
+        if (inst.opCode != Stage1OpCode::Step) {
+            continue;
+        }
+        bool isNextMul = i + 1 < instructions.size() && instructions[i + 1].opCode == Stage1OpCode::Step
+            && instructions[i + 1].tplCount + instructions[i + 1].dblCount > 0;
+        auto nextInputSystem = isNextMul ? CoordinateSystem::Projective : CoordinateSystem::Extended;
+        inst.addOutput = nextInputSystem;
+        inst.mulOutput = inst.addType == Stage1AddType::None ? nextInputSystem : CoordinateSystem::Extended;
+    }
+
+    // tables are normalized if they are used by enough additions of their block
+    for (std::size_t i = 0; i < instructions.size(); ++i) {
+        auto& table = instructions[i];
+        if (table.opCode != Stage1OpCode::NafTable && table.opCode != Stage1OpCode::DbChainTable) {
+            continue;
+        }
+        int addCount = 0;
+        for (auto j = i + 1; j < instructions.size() && instructions[j].opCode == Stage1OpCode::Step; ++j) {
+            addCount += instructions[j].addType != Stage1AddType::None;
+        }
+        table.isAffineTable = twistedEdwardsUseAffineTable(stage1TableSize(table), addCount);
+    }
+    return program;
+}
+
+template<typename Curve, typename Type> void stage1Dbl(Curve& curve, CurvePoint<Type>& p, CoordinateSystem outputSystem) {
+    if constexpr (Curve::Form == EllipticCurveForm::TwistedEdwards) {
+        twistedEdwardsDbl(curve, p, outputSystem);
+    } else if constexpr (Curve::Form == EllipticCurveForm::ShortWeierstrass) {
+        shortWeierstrassDbl(curve, p);
+    } else {
+        montgomeryDbl(curve, p, p);
+    }
+}
+template<typename Curve, typename Type> void stage1Tpl(Curve& curve, CurvePoint<Type>& p, CoordinateSystem outputSystem) {
+    if constexpr (Curve::Form == EllipticCurveForm::TwistedEdwards) {
+        twistedEdwardsTpl(curve, p, outputSystem);
+    } else {
+        debugAssert(false, "tpl is only supported in TwistedEdwards form");
+    }
+}
+template<typename Curve, typename Type> void stage1AddSub(Curve& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q, bool isAdd, CoordinateSystem outputSystem) {
+    if constexpr (Curve::Form == EllipticCurveForm::TwistedEdwards) {
+        _twistedEdwardsAddsub(curve, p, q, outputSystem, isAdd);
+    } else if constexpr (Curve::Form == EllipticCurveForm::ShortWeierstrass) {
+        _shortWeierstrassAddsub(curve, p, q, isAdd);
+    } else {
+        debugAssert(false, "cannot add using Montgomery form");
+    }
+}
+
+template<typename Curve, typename Type> void stage1MixedAddSub(Curve& curve, CurvePoint<Type>& p, const CurvePoint<Type>& q, bool isAdd, CoordinateSystem outputSystem) {
+    if constexpr (Curve::Form == EllipticCurveForm::TwistedEdwards) {
+        _twistedEdwardsMixedAddsub(curve, p, q, outputSystem, isAdd);
+    } else {
+        debugAssert(false, "mixed additions are only supported in TwistedEdwards form");
+    }
+}
+// returns false if the table stays in extended coordinates (other forms, curves in lanes that have no modular
+// inversion or some Z that is not invertible)
+template<typename Curve, typename Type> bool stage1NormalizeTable(Curve& curve, std::span<CurvePoint<Type>> table) {
+    if constexpr (Curve::Form == EllipticCurveForm::TwistedEdwards && requires(Type& r, const Type& a) { modInv(r, a, curve.mod); }) {
+        return twistedEdwardsToCachedAffine(curve, table);
+    } else {
+        return false;
+    }
+}
+
+template<typename Curve, typename Type> void runStage1Step(const Stage1Instruction& inst, Curve& curve, CurvePoint<Type>& p, const std::array<CurvePoint<Type>, 256>& points, bool isTableAffine) {
+    for (uint32_t i = 1; i < inst.tplCount; ++i) {
+        stage1Tpl(curve, p, CoordinateSystem::Projective);
+    }
+    if (inst.tplCount > 0) {
+        stage1Tpl(curve, p, inst.dblCount > 0 ? CoordinateSystem::Projective : inst.mulOutput);
+    }
+    for (uint32_t i = 1; i < inst.dblCount; ++i) {
+        stage1Dbl(curve, p, CoordinateSystem::Projective);
+    }
+    if (inst.dblCount > 0) {
+        stage1Dbl(curve, p, inst.mulOutput);
+    }
+    if (inst.addType != Stage1AddType::None) {
+        if (isTableAffine) {
+            stage1MixedAddSub(curve, p, points[inst.index], inst.addType == Stage1AddType::Add, inst.addOutput);
+        } else {
+            stage1AddSub(curve, p, points[inst.index], inst.addType == Stage1AddType::Add, inst.addOutput);
+        }
+    }
+}
+
+template<typename Curve, typename Type> void runStage1PracRule(const Stage1Instruction& inst, Curve& curve, std::array<CurvePoint<Type>, 256>& points, CurvePoint<Type>& p) {
+    auto& tmp = curve.tmp[0];
+    auto& A = p;
+    auto& B = points[0];
+    auto& C = points[1];
+    auto& T = points[2];
+    auto& U = points[3];
+    for (uint32_t i = 0; i < inst.tplCount; ++i) {
+        if (inst.startIndex) {
+            pracSwap(A, B);
+        }
+        switch (static_cast<bytecode::PracOpCode>(inst.index)) {
+        case bytecode::PracOpCode::Rule1:
+            montgomeryDiffAdd(curve, T, A, B, C);
+            montgomeryDiffAdd(curve, U, T, A, B);
+            montgomeryDiffAdd(curve, B, B, T, A);
+            pracSwap(A, U);
+            break;
+        case bytecode::PracOpCode::Rule2:
+            montgomeryDiffAdd(curve, B, A, B, C);
+            montgomeryDbl(curve, A, A);
+            break;
+        case bytecode::PracOpCode::Rule3:
+            montgomeryDiffAdd(curve, T, B, A, C);
+            pracSwap3(tmp, B, T, C);
+            break;
+        case bytecode::PracOpCode::Rule4:
+            montgomeryDiffAdd(curve, B, B, A, C);
+            montgomeryDbl(curve, A, A);
+            break;
+        case bytecode::PracOpCode::Rule5:
+            montgomeryDiffAdd(curve, C, C, A, B);
+            montgomeryDbl(curve, A, A);
+            break;
+        case bytecode::PracOpCode::Rule6:
+            montgomeryDbl(curve, T, A);
+            montgomeryDiffAdd(curve, U, A, B, C);
+            montgomeryDiffAdd(curve, A, T, A, A);
+            montgomeryDiffAdd(curve, T, T, U, C);
+            pracSwap3(tmp, C, B, T);
+            break;
+        case bytecode::PracOpCode::Rule7:
+            montgomeryDiffAdd(curve, T, A, B, C);
+            montgomeryDiffAdd(curve, B, T, A, B);
+            montgomeryDbl(curve, T, A);
+            montgomeryDiffAdd(curve, A, A, T, A);
+            break;
+        case bytecode::PracOpCode::Rule8:
+            montgomeryDiffAdd(curve, T, A, B, C);
+            montgomeryDiffAdd(curve, C, C, A, B);
+            pracSwap(B, T);
+            montgomeryDbl(curve, T, A);
+            montgomeryDiffAdd(curve, A, A, T, A);
+            break;
+        case bytecode::PracOpCode::Rule9:
+            montgomeryDiffAdd(curve, C, C, B, A);
+            montgomeryDbl(curve, B, B);
+            break;
+        case bytecode::PracOpCode::End:
+            break;
+        }
+    }
+}
+
+template<typename Curve, typename Type> void runStage1ProgramOnForm(const Stage1Program& program, Curve& curve, CurvePoint<Type>& p) {
+    constexpr auto Form = Curve::Form;
+    std::array<CurvePoint<Type>, 256> points;
+    bool isTableAffine = false;
+    for (auto& inst : program.instructions) {
+        switch (inst.opCode) {
+        case Stage1OpCode::Step:
+            runStage1Step(inst, curve, p, points, isTableAffine);
+            break;
+        case Stage1OpCode::NafTable:
+            points[0] = p;
+            if (inst.index > 1) {
+                points.back() = p;
+                stage1Dbl(curve, points.back(), CoordinateSystem::Extended);
+                for (int i = 1; i < inst.index; ++i) {
+                    points[i] = points[i - 1];
+                    stage1AddSub(curve, points[i], points.back(), true, CoordinateSystem::Extended);
+                }
+                p = points[inst.startIndex];
+            }
+            isTableAffine = inst.isAffineTable && stage1NormalizeTable(curve, std::span(points.data(), stage1TableSize(inst)));
+            break;
+        case Stage1OpCode::DbChainTable:
+            points[0] = p;
+            if (inst.index > 0) {
+                stage1Dbl(curve, p, CoordinateSystem::Extended);
+                for (int i = 1; i <= inst.index; ++i) {
+                    points[i] = points[i - 1];
+                    stage1AddSub(curve, points[i], p, true, CoordinateSystem::Extended);
+                }
+                if (inst.startIndex != 0) {
+                    p = points[inst.startIndex];
+                }
+            }
+            isTableAffine = inst.isAffineTable && stage1NormalizeTable(curve, std::span(points.data(), stage1TableSize(inst)));
+            break;
+        case Stage1OpCode::PracStart:
+            if constexpr (Form == EllipticCurveForm::Montgomery) {
+                points[0] = p;
+                points[1] = p;
+                points[2] = p;
+                points[3] = p;
+                montgomeryDbl(curve, p, p);
+            } else {
+                debugAssert(false, "PRAC is only supported in Montgomery form");
+            }
+            break;
+        case Stage1OpCode::PracRule:
+            if constexpr (Form == EllipticCurveForm::Montgomery) {
+                runStage1PracRule(inst, curve, points, p);
+            }
+            break;
+        case Stage1OpCode::PracEnd:
+            if constexpr (Form == EllipticCurveForm::Montgomery) {
+                montgomeryDiffAdd(curve, p, p, points[0], points[1]);
+            }
+            break;
+        }
+    }
+}
+
+template<typename Type, typename ModType> void runStage1Program(const Stage1Program& program, EllipticCurve<Type, ModType>& curve, CurvePoint<Type>& point) {
+    visitCurveForm(curve, [&](auto&& formCurve) {
+        runStage1ProgramOnForm(program, formCurve, point);
+    });
+}
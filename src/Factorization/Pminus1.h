@@ -1,9 +1,12 @@
 #pragma once
-#include "../PrecomputedTables/primeTable.h"
+#include "../PrecomputedTables/primeSieve.h"
 #include "../BigInt/common.h"
+#include "../BigInt/PolynomialGmp.h"
+#include "stage2.h"
 #include <vector>
 #include <cstdint>
 #include <numeric>
+#include <chrono>
 
 template<typename Type, typename ModType> void SquareAndMultiply(Type& a, const ModType& m, uint64_t n) {
     auto b = a;
@@ -15,26 +18,172 @@ template<typename Type, typename ModType> void SquareAndMultiply(Type& a, const
     }
 }
 
-template<typename ModType> BigIntValueType<ModType> pMinus1(const ModType& n, uint64_t B1, uint64_t B2) {
+// V_k = x^k + x^-k from v1 = V_1 (Lucas ladder: V_2k = V_k^2 - 2, V_2k+1 = V_k * V_k+1 - V_1)
+template<typename Type, typename ModType> Type lucasV(const Type& v1, uint64_t k, const ModType& m) {
+    Type two = getConstant(2, m);
+    Type vk = two;
+    Type vk1 = v1;
+    Type tmp;
+    for (auto i = mostSignificantBit(k); i > 0; i >>= 1) {
+        modMul(tmp, vk, vk1, m);
+        modSub(tmp, tmp, v1, m);
+        if (k & i) {
+            modSqr(vk1, vk1, m);
+            modSub(vk1, vk1, two, m);
+            vk = tmp;
+        } else {
+            modSqr(vk, vk, m);
+            modSub(vk, vk, two, m);
+            vk1 = tmp;
+        }
+    }
+    return vk;
+}
+
+// V_j for all baby steps j of the plan (V_(j+2) = V_j * V_2 - V_(j-2))
+template<typename Type, typename ModType> std::vector<Type> pMinus1BabyValues(const Type& v1, const Stage2Plan& plan, const ModType& m) {
+    auto babyCount = plan.babySteps.size();
+    std::vector<Type> babyValues(babyCount);
+    Type v2 = lucasV(v1, 2, m);
+    Type baby = v1;
+    Type previousBaby = v1;
+    Type nextBaby;
+    int j = 1;
+    for (std::size_t b = 0; b < babyCount; j += 2) {
+        if (j > 1) {
+            modMul(nextBaby, baby, v2, m);
+            modSub(nextBaby, nextBaby, previousBaby, m);
+            swap(previousBaby, baby);
+            swap(baby, nextBaby);
+        }
+        if (j == plan.babySteps[b]) {
+            babyValues[b] = baby;
+            b += 1;
+        }
+    }
+    return babyValues;
+}
+
+// Stage 2 (baby-step giant-step): with V_k = x^k + x^-k, V_gD - V_j = x^-gD * (x^gD - x^j) * (x^gD - x^-j),
+// so it is divisible by p if x^(gD - j) = 1 or x^(gD + j) = 1 (mod p)
+template<typename ModType> BigIntValueType<ModType> pMinus1Stage2(const ModType& n, const BigIntValueType<ModType>& x, const Stage2Plan& plan) {
+    using T = BigIntValueType<ModType>;
+    auto one = T{ 1 };
+    T xInverse, v1;
+    modInv(xInverse, x, n);
+    modAdd(v1, x, xInverse, n);
+    auto babyValues = pMinus1BabyValues(v1, plan, n);
+
+    // giant steps: V_(g+1)D = V_gD * V_D - V_(g-1)D
+    T giantStep = lucasV(v1, plan.D, n);
+    T giant = lucasV(v1, plan.firstGiant * plan.D, n);
+    T nextGiant = lucasV(v1, (plan.firstGiant + 1) * plan.D, n);
+    T accumulator = getConstant(1, n);
+    T difference;
+    T a = one;
+    constexpr uint64_t gcdInterval = 1024;
+    forEachStage2Giant(plan, [&](uint64_t giantIndex, const uint64_t* mask) {
+        forEachStage2Pair(plan, mask, [&](int b) {
+            modSub(difference, giant, babyValues[b], n);
+            modMul(accumulator, accumulator, difference, n);
+        });
+        modMul(difference, nextGiant, giantStep, n);
+        modSub(difference, difference, giant, n);
+        swap(giant, nextGiant);
+        swap(nextGiant, difference);
+
+        if ((giantIndex + 1) % gcdInterval == 0 || giantIndex + 1 == plan.giantCount) {
+            if (isZero(accumulator)) {
+                return false;
+            }
+            gcd(a, accumulator, n);
+            return a == one;
+        }
+        return true;
+    });
+    if (isZero(accumulator)) {
+        return one;
+    }
+    return a;
+}
+
+// Stage 2 with polynomial arithmetic (FFT continuation): prod (V_gD - V_j) over all baby steps j and a batch
+// of giant steps g is the product of values of G(X) = prod (X - V_gD) at all V_j, which are computed with a remainder
+// tree over the product tree of baby values (built once). Every V_gD - V_j is multiplied in (not only the prime pairs),
+// but the cost per giant step is O(log^2) multiplications instead of one multiplication per prime pair.
+// Values are plain residues (not in Montgomery form).
+BigIntGmp pMinus1PolynomialStage2(const BigIntGmp& n, const BigIntGmp& x, const Stage2Plan& plan) {
+    constexpr uint64_t GiantsPerBaby = 4; // batches bigger than the number of baby steps make the remainder tree cheaper per giant
+    auto batchSize = std::min(plan.giantCount, std::max<uint64_t>(1, GiantsPerBaby * plan.babySteps.size()));
+    BigIntGmp one = 1;
+    BigIntGmp xInverse, v1;
+    modInv(xInverse, x, n);
+    modAdd(v1, x, xInverse, n);
+    auto babyTree = polyProductTree(pMinus1BabyValues(v1, plan, n), n, static_cast<int>(batchSize));
+
+    BigIntGmp giantStep = lucasV(v1, plan.D, n);
+    BigIntGmp giant = lucasV(v1, plan.firstGiant * plan.D, n);
+    BigIntGmp nextGiant = lucasV(v1, (plan.firstGiant + 1) * plan.D, n);
+    BigIntGmp accumulator = one;
+    BigIntGmp a;
+    std::vector<BigIntGmp> giants, values;
+    for (uint64_t batchBegin = 0; batchBegin < plan.giantCount; batchBegin += batchSize) {
+        giants.resize(std::min(batchSize, plan.giantCount - batchBegin));
+        for (auto& value : giants) {
+            value = giant;
+            modMul(giant, nextGiant, giantStep, n);
+            modSub(giant, giant, value, n);
+            swap(giant, nextGiant);
+        }
+        polyMultipointEvaluate(values, polyFromRoots(giants, n), babyTree, n);
+        for (auto& value : values) {
+            modMul(accumulator, accumulator, value, n);
+        }
+        if (isZero(accumulator)) {
+            return one;
+        }
+        gcd(a, accumulator, n);
+        if (a != one) {
+            return a;
+        }
+    }
+    return a;
+}
+
+struct PMinus1Params {
+    PMinus1Params(uint64_t B1, uint64_t B2, bool useFftStage2=false) : B1(B1), B2(B2), useFftStage2(useFftStage2), out_stage1Time(0), out_stage2Time(0) {}
+    uint64_t B1;
+    uint64_t B2;
+    bool useFftStage2;     // use polynomial stage 2, which is much faster for big B2
+    double out_stage1Time; // in seconds
+    double out_stage2Time;
+};
+
+template<typename ModType> BigIntValueType<ModType> pMinus1(PMinus1Params& params, const ModType& n) {
     using T = BigIntValueType<ModType>;
     auto one = T{ 1 };
     //auto modValue = getModValue(n);
     auto oneConst = getConstant(1, n);
+    auto B1 = params.B1;
+    auto B2 = params.B2;
+    params.out_stage1Time = 0;
+    params.out_stage2Time = 0;
 
     // Stage 1
+    auto stage1Start = std::chrono::steady_clock::now();
     T x = getConstant(2, n);
-    int i = 0;
-    for (; Primes_1_000_000[i] <= B1; ++i) {
-        uint64_t p = Primes_1_000_000[i];
+    for (auto prime : PrimeSieve(2, B1)) {
+        uint64_t p = prime;
         uint64_t q;
         do {
             q = p;
-            p *= Primes_1_000_000[i];
+            p *= prime;
         } while (p <= B1);
         SquareAndMultiply(x, n, q);
     }
     T xm1;
     sub(xm1, x, oneConst);
+    params.out_stage1Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - stage1Start).count();
     if (isZero(xm1)) {
         return one;
     }
@@ -45,53 +194,26 @@ template<typename ModType> BigIntValueType<ModType> pMinus1(const ModType& n, ui
     }
 
     // Stage 2
-    uint64_t firstPrime = Primes_1_000_000[i];
-    uint64_t prevPrime = firstPrime;
-    i += 1;
-    std::vector<int> primeDifferencesBetweenB1B2;
-    for (; Primes_1_000_000[i] <= B2; ++i) {
-        primeDifferencesBetweenB1B2.emplace_back(Primes_1_000_000[i] - prevPrime);
-        prevPrime = Primes_1_000_000[i];
-    }
-    int maxDiff = *std::max_element(primeDifferencesBetweenB1B2.begin(), primeDifferencesBetweenB1B2.end());
-    std::vector<T> diffTable(maxDiff / 2);
-    diffTable[0] = x;
-    modSqr(diffTable[0], diffTable[0], n);
-    diffTable[1] = diffTable[0];
-    modSqr(diffTable[1], diffTable[1], n);
-    for (int j = 2; j < maxDiff / 2; ++j) {
-        diffTable[j] = diffTable[j - 1];
-        modMul(diffTable[j], diffTable[j], diffTable[0], n);
-    }
-
-    SquareAndMultiply(x, n, firstPrime);
-    T runningMult = x;
-    int gcdInterval = 100;
-    int gcdCount = 0;
-    for (int diff : primeDifferencesBetweenB1B2) {
-        modMul(x, x, diffTable[diff / 2 - 1], n);
-        modMul(runningMult, runningMult, x, n);
-        if (gcdCount == gcdInterval) {
-            sub(xm1, runningMult, oneConst);
-            if (!isZero(xm1)) {
-                gcd(a, xm1, n);
-                if (a != one) {
-                    return a;
-                }
-            }
-            gcdCount = 0;
+    auto stage2Start = std::chrono::steady_clock::now();
+    auto plan = params.useFftStage2 ? createPolynomialStage2Plan(B1, B2) : createStage2Plan(B1, B2);
+    if (plan.giantCount > 0) {
+        if (params.useFftStage2) {
+            a = T{ pMinus1PolynomialStage2(BigIntGmp{ getModValue(n) }, BigIntGmp{ convertToValue(x, n) }, plan) };
         } else {
-            gcdCount += 1;
+            a = pMinus1Stage2(n, x, plan);
         }
     }
-    sub(xm1, runningMult, oneConst);
-    if (isZero(xm1)) {
-        return one;
-    }
-    gcd(a, xm1, n);
+    params.out_stage2Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - stage2Start).count();
     return a;
 }
+template<typename ModType> BigIntValueType<ModType> pMinus1(const ModType& n, uint64_t B1, uint64_t B2) {
+    PMinus1Params params(B1, B2);
+    return pMinus1(params, n);
+}
 
+BigInt pMinus1(PMinus1Params& params, const BigInt& n) {
+    return n.visit([&params](auto&& a) { return BigInt{ pMinus1(params, a) }; });
+}
 BigInt pMinus1(const BigInt& n, uint64_t B1, uint64_t B2) {
     return n.visit([B1,B2](auto&& a) { return BigInt{ pMinus1(a, B1, B2) }; });
 }
@@ -1,8 +1,13 @@
 #pragma once
+#include "../BigInt/Montgomery64.h"
+#include "../BigInt/Unsigned64.h"
 #include <vector>
+#include <array>
+#include <algorithm>
 #include <cstdint>
 
 struct PollardRhoParams {
+    PollardRhoParams() : PollardRhoParams(0, 1'000'000) {}
     PollardRhoParams(uint64_t batchIterSize, uint64_t maxIterCount) : batchIterSize(batchIterSize), maxIterCount(maxIterCount), out_iterCount(0) {}
     uint64_t batchIterSize;
     uint64_t maxIterCount;
@@ -151,7 +156,84 @@ template<typename ModType> BigIntValueType<ModType> pollardRho(PollardRhoParams&
     return one;
 }
 
+// Brent's rho for 1-limb n on Montgomery64. PollardRho64WalkCount walks x -> x^2 + c (with different c) run in one
+// loop; they are independent, so the multiplications of one walk hide the latency of the others. Products of |x - y|
+// of all walks are checked with one binary gcd every batchIterSize iterations (PollardRho64BatchIterSize if 0).
+// out_iterCount counts iterations of all walks.
+constexpr int PollardRho64WalkCount = 2;
+constexpr uint64_t PollardRho64BatchIterSize = 128;
+uint64_t pollardRhoBrent(PollardRhoParams& params, uint64_t n) {
+    if (n % 2 == 0) {
+        return 2;
+    }
+    constexpr int W = PollardRho64WalkCount;
+    Montgomery64 mont(n);
+    auto batchIterSize = params.batchIterSize == 0 ? PollardRho64BatchIterSize : params.batchIterSize;
+    auto step = [&mont](uint64_t x, uint64_t c) { return mont.add(mont.sqr(x), c); };
+    auto absDiff = [](uint64_t a, uint64_t b) { return a > b ? a - b : b - a; };
+    std::array<uint64_t, W> c, x, y, xs, q;
+    params.out_iterCount = 0;
+    for (uint64_t firstC = 1;; firstC += W) {
+        for (int w = 0; w < W; ++w) {
+            c[w] = mont.toMontgomery(firstC + w);
+            x[w] = mont.toMontgomery(2);
+            q[w] = mont.one;
+        }
+        bool failed = false;
+        for (uint64_t r = 1; !failed; r *= 2) {
+            if (params.out_iterCount >= params.maxIterCount) {
+                return 1;
+            }
+            y = x;
+            for (uint64_t i = 0; i < r; ++i) {
+                for (int w = 0; w < W; ++w) {
+                    x[w] = step(x[w], c[w]);
+                }
+            }
+            params.out_iterCount += W * r;
+            for (uint64_t k = 0; k < r && !failed; k += batchIterSize) {
+                xs = x;
+                auto end = std::min(batchIterSize, r - k);
+                for (uint64_t i = 0; i < end; ++i) {
+                    for (int w = 0; w < W; ++w) {
+                        x[w] = step(x[w], c[w]);
+                        q[w] = mont.mul(q[w], absDiff(x[w], y[w]));
+                    }
+                }
+                params.out_iterCount += W * end;
+                auto product = q[0];
+                for (int w = 1; w < W; ++w) {
+                    product = mont.mul(product, q[w]);
+                }
+                if (binaryGcd(product, n) == 1) {
+                    continue;
+                }
+                for (int w = 0; w < W; ++w) {
+                    auto d = binaryGcd(q[w], n);
+                    if (d != n) {
+                        if (d != 1) return d;
+                        continue;
+                    }
+                    // walk reached 0 (mod n), try backtracking
+                    d = 1;
+                    for (uint64_t i = 0; i < end && d == 1; ++i) {
+                        xs[w] = step(xs[w], c[w]);
+                        d = binaryGcd(absDiff(xs[w], y[w]), n);
+                    }
+                    if (d != 1 && d != n) {
+                        return d;
+                    }
+                    failed = true; // start again with new 'c'
+                }
+            }
+        }
+    }
+}
+
 BigInt pollardRhoBrent(PollardRhoParams& params, const BigInt& n) {
+    if (n.IsType<BigIntFixedSize<1>>()) {
+        return BigInt{ pollardRhoBrent(params, n.get<BigIntFixedSize<1>>()[0]) };
+    }
     return n.visit([&params](auto&& a) { return BigInt{ pollardRhoBrent(params, a) }; });
 }
 BigInt pollardRho(PollardRhoParams& params, const BigInt& n) {
@@ -0,0 +1,228 @@
+#pragma once
+#include "PollardRho.h"
+#include "../BigInt/kernels.h"
+#include "../BigInt/BigIntFixedSizeLanes.h"
+#include "../BigInt/64bitIntrinsics.h"
+#include "../BigInt/Unsigned64.h"
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Pollard-Brent rho in LaneCount SIMD lanes for moduli below 2^PollardRhoLanesMaxBits.
+    Every lane is one 52-bit digit with Montgomery form R = 2^52 (like lane kernels with D = 1), and has its own
+    modulus and constant c, so the lanes can run:
+    - several walks x -> x^2 + c of one number with different c (pollardRhoBrentLanes), which hides the latency
+      of a single walk,
+    - one walk for each of LaneCount different numbers (pollardRhoBrentBatch).
+    All lanes step together, so they share the Brent cycle length r. A lane that collapsed to 0 (mod n)
+    restarts with a new c without stopping the others.
+    With AVX-512 IFMA and 8 lanes the iterations keep all values in registers, otherwise they use the lane kernels.
+*/
+constexpr int PollardRhoLanesMaxBits = 51; // Montgomery results are below 2n, which has to fit in one digit
+constexpr std::size_t PollardRhoLanesCount = BigIntLanesDefaultCount;
+constexpr uint64_t PollardRhoLanesBatchIterSize = 512; // one iteration of all lanes is cheap compared to their gcds
+
+template<std::size_t L> struct PollardRhoLanesState {
+    alignas(64) std::array<uint64_t, L> n;
+    alignas(64) std::array<uint64_t, L> k; // -n^-1 mod 2^52
+    alignas(64) std::array<uint64_t, L> one;
+    alignas(64) std::array<uint64_t, L> c;
+    alignas(64) std::array<uint64_t, L> x;
+    alignas(64) std::array<uint64_t, L> y;
+    alignas(64) std::array<uint64_t, L> xs;
+    alignas(64) std::array<uint64_t, L> q;
+    alignas(64) std::array<uint64_t, L> difference;
+
+    // a * 2^52 mod n
+    static uint64_t toMontgomery(uint64_t a, uint64_t n) {
+        a %= n;
+        auto quotient = div128(a >> 12, a << 52, n);
+        return (a << 52) - quotient * n;
+    }
+    void setLane(std::size_t l, uint64_t laneN, uint64_t laneC) {
+        debugAssert(laneN % 2 == 1 && laneN < (1ull << PollardRhoLanesMaxBits));
+        n[l] = laneN;
+        uint64_t inverse = 1;
+        for (int i = 0; i < 6; ++i) {
+            inverse *= 2 - laneN * inverse;
+        }
+        k[l] = (0 - inverse) & bigIntKernels::LaneDigitMask;
+        one[l] = toMontgomery(1, laneN);
+        restartLane(l, laneC);
+    }
+    void restartLane(std::size_t l, uint64_t laneC) {
+        c[l] = toMontgomery(laneC, n[l]);
+        x[l] = toMontgomery(2, n[l]);
+        y[l] = x[l]; // the saved value of the old walk would be mixed with the new one
+        q[l] = one[l];
+    }
+    // v = v^2 + c
+    void step(std::array<uint64_t, L>& v) {
+        bigIntKernels::montgomerySqrLanes<1, L>(v.data(), v.data(), k.data(), n.data());
+        bigIntKernels::modAddLanes<1, L>(v.data(), v.data(), c.data(), n.data());
+    }
+    // count times x = x^2 + c, and if isAccumulating also q *= x - y
+    void steps(uint64_t count, bool isAccumulating) {
+        #ifdef AVX512_IFMA_IS_AVAILABLE
+        if constexpr (L == 8) {
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i nn = _mm512_load_si512(n.data());
+            const __m512i kk = _mm512_load_si512(k.data());
+            const __m512i cc = _mm512_load_si512(c.data());
+            const __m512i yy = _mm512_load_si512(y.data());
+            __m512i xx = _mm512_load_si512(x.data());
+            __m512i qq = _mm512_load_si512(q.data());
+            // a * b / 2^52 mod n, a - n wraps around for a < n, so min(a, a - n) reduces a < 2n
+            auto mul = [&](__m512i a, __m512i b) {
+                __m512i low = _mm512_madd52lo_epu64(zero, a, b);
+                __m512i high = _mm512_madd52hi_epu64(zero, a, b);
+                __m512i m = _mm512_madd52lo_epu64(zero, low, kk);
+                low = _mm512_madd52lo_epu64(low, m, nn);
+                high = _mm512_madd52hi_epu64(high, m, nn);
+                __m512i r = _mm512_add_epi64(high, _mm512_maskz_srli_epi64(0xFF, low, 52));
+                return _mm512_maskz_min_epu64(0xFF, r, _mm512_sub_epi64(r, nn));
+            };
+            for (uint64_t i = 0; i < count; ++i) {
+                xx = mul(xx, xx);
+                xx = _mm512_add_epi64(xx, cc);
+                xx = _mm512_maskz_min_epu64(0xFF, xx, _mm512_sub_epi64(xx, nn));
+                if (isAccumulating) {
+                    __m512i d = _mm512_sub_epi64(xx, yy);
+                    d = _mm512_maskz_min_epu64(0xFF, d, _mm512_add_epi64(d, nn));
+                    qq = mul(qq, d);
+                }
+            }
+            _mm512_store_si512(x.data(), xx);
+            _mm512_store_si512(q.data(), qq);
+            return;
+        }
+        #endif
+        for (uint64_t i = 0; i < count; ++i) {
+            step(x);
+            if (isAccumulating) {
+                bigIntKernels::modSubLanes<1, L>(difference.data(), x.data(), y.data(), n.data());
+                bigIntKernels::montgomeryMultLanes<1, L>(q.data(), q.data(), difference.data(), k.data(), n.data());
+            }
+        }
+    }
+};
+
+// Brent's rho for every lane. params[l] give maxIterCount and get out_iterCount of lane l (batchIterSize of lane 0
+// is used for all lanes, PollardRhoLanesBatchIterSize if 0). Lanes with factors[l] != 1 are already finished.
+// Returns factor found in every lane or 1. If stopAtFirst is set, all lanes have the same modulus and maxIterCount,
+// and they stop once any of them found a factor.
+template<std::size_t L> std::array<uint64_t, L> pollardRhoBrentLanes_(std::array<PollardRhoParams, L>& params, PollardRhoLanesState<L>& s, std::array<uint64_t, L> factors, std::array<uint64_t, L> nextC, bool stopAtFirst) {
+    std::array<bool, L> isDone;
+    for (std::size_t l = 0; l < L; ++l) {
+        params[l].out_iterCount = 0;
+        isDone[l] = factors[l] != 1;
+    }
+    auto batchIterSize = params[0].batchIterSize == 0 ? PollardRhoLanesBatchIterSize : params[0].batchIterSize;
+    Montgomery64 mont(s.n[0]);
+    auto finishLane = [&](std::size_t l, uint64_t factor) {
+        factors[l] = factor;
+        isDone[l] = true;
+        return stopAtFirst || std::all_of(isDone.begin(), isDone.end(), [](bool done) { return done; });
+    };
+    for (uint64_t r = 1;; r *= 2) {
+        s.y = s.x;
+        s.steps(r, false);
+        for (std::size_t l = 0; l < L; ++l) {
+            params[l].out_iterCount += isDone[l] ? 0 : r;
+        }
+        for (uint64_t k = 0; k < r; k += batchIterSize) {
+            s.xs = s.x;
+            auto end = std::min(batchIterSize, r - k);
+            s.steps(end, true);
+            if (stopAtFirst) {
+                // lanes share the modulus (Montgomery forms with different R don't matter for the gcd)
+                auto product = s.q[0];
+                for (std::size_t l = 1; l < L; ++l) {
+                    product = mont.mul(product, s.q[l]);
+                }
+                if (binaryGcd(product, s.n[0]) == 1) {
+                    for (std::size_t l = 0; l < L; ++l) {
+                        params[l].out_iterCount += end;
+                    }
+                    if (params[0].out_iterCount >= params[0].maxIterCount) {
+                        return factors;
+                    }
+                    continue;
+                }
+            }
+            for (std::size_t l = 0; l < L; ++l) {
+                if (isDone[l]) {
+                    continue;
+                }
+                params[l].out_iterCount += end;
+                auto d = binaryGcd(s.q[l], s.n[l]);
+                if (d == s.n[l]) {
+                    // lane reached 0 (mod n), try backtracking (all lanes are stepped, only this one is checked)
+                    auto xs = s.xs;
+                    d = 1;
+                    for (uint64_t i = 0; i < end && d == 1; ++i) {
+                        s.step(xs);
+                        d = binaryGcd(xs[l] > s.y[l] ? xs[l] - s.y[l] : s.y[l] - xs[l], s.n[l]);
+                    }
+                    if (d == s.n[l] || d == 1) {
+                        s.restartLane(l, nextC[l]);
+                        nextC[l] += L;
+                        continue;
+                    }
+                }
+                if (d != 1 && finishLane(l, d)) {
+                    return factors;
+                }
+                if (params[l].out_iterCount >= params[l].maxIterCount && finishLane(l, 1)) {
+                    return factors;
+                }
+            }
+        }
+    }
+}
+
+// L walks with constants 1..L of one odd n < 2^PollardRhoLanesMaxBits, out_iterCount counts iterations of all walks
+template<std::size_t L = PollardRhoLanesCount> uint64_t pollardRhoBrentLanes(PollardRhoParams& params, uint64_t n) {
+    if (n % 2 == 0) {
+        return 2;
+    }
+    PollardRhoLanesState<L> state;
+    std::array<PollardRhoParams, L> laneParams;
+    std::array<uint64_t, L> factors;
+    std::array<uint64_t, L> nextC;
+    for (std::size_t l = 0; l < L; ++l) {
+        state.setLane(l, n, l + 1);
+        laneParams[l] = PollardRhoParams(params.batchIterSize, (params.maxIterCount + L - 1) / L);
+        factors[l] = 1;
+        nextC[l] = l + 1 + L;
+    }
+    factors = pollardRhoBrentLanes_(laneParams, state, factors, nextC, true);
+    params.out_iterCount = 0;
+    for (auto& laneParam : laneParams) {
+        params.out_iterCount += laneParam.out_iterCount;
+    }
+    for (auto factor : factors) {
+        if (factor != 1 && factor != n) {
+            return factor;
+        }
+    }
+    return 1;
+}
+
+// one walk for each of L numbers below 2^PollardRhoLanesMaxBits. Returns a factor of every n[l] (or 1 if its
+// params[l].maxIterCount was reached), params[l].out_iterCount is the iteration count of lane l.
+template<std::size_t L = PollardRhoLanesCount> std::array<uint64_t, L> pollardRhoBrentBatch(std::array<PollardRhoParams, L>& params, const std::array<uint64_t, L>& n) {
+    PollardRhoLanesState<L> state;
+    std::array<uint64_t, L> factors;
+    std::array<uint64_t, L> nextC;
+    for (std::size_t l = 0; l < L; ++l) {
+        // even lanes are finished right away, they only need a valid modulus for the kernels
+        bool isEven = n[l] % 2 == 0;
+        state.setLane(l, isEven ? 1 : n[l], 1);
+        factors[l] = isEven ? 2 : 1;
+        nextC[l] = 2;
+    }
+    return pollardRhoBrentLanes_(params, state, factors, nextC, false);
+}
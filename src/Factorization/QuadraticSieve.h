@@ -0,0 +1,704 @@
+#pragma once
+#include "../BigInt/BigIntGmp.h"
+#include "../BigInt/BigInt.h"
+#include "../PrecomputedTables/primeTable.h"
+#include "../Utility/bitManipulation.h"
+#include "../Utility/generalUtils.h"
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <cstring>
+
+/*
+    Self-initializing quadratic sieve (SIQS) for 40-100 digit numbers without small factors.
+
+    Relations are (Ax + B)^2 = A * g(x) (mod n) with g(x) = Ax^2 + 2Bx + C, C = (B^2 - kN) / A, for x in [-M, M).
+    A is a product of s factor base primes, which gives 2^(s-1) values of B; consecutive ones differ by a single
+    2*B_l (Gray code order), so roots of all factor base primes are updated with one addition each.
+    The interval is sieved in blocks that fit in L1 cache, primes below SiqsSmallPrimeLimit are not sieved
+    (small prime variation), and relations with one prime above the factor base (partial relations) are combined
+    in pairs with the same prime (large prime variation).
+    Dependencies are found with structured Gaussian elimination: singletons and light columns are removed by merging
+    relations, and only the rest is eliminated as a dense matrix.
+*/
+constexpr uint32_t SiqsBlockSize = 32 * 1024;
+constexpr uint32_t SiqsSmallPrimeLimit = 32;
+constexpr int SiqsExcessRelations = 64;
+constexpr int SiqsMaxMergeWeight = 16;
+constexpr int SiqsLargePrimeMultiplier = 100; // bound for the large prime is SiqsLargePrimeMultiplier * biggest factor base prime
+constexpr double SiqsThresholdMargin = 6;     // logs are rounded and prime powers are sieved only once
+constexpr double SiqsAFactorSize = 2000;      // preferred size of primes of A
+
+struct SiqsSizeParams {
+    int digits;
+    int factorBaseSize;
+    int blockCount; // 2M = blockCount * SiqsBlockSize
+};
+const std::vector<SiqsSizeParams> SiqsSizeParamsTable = {
+    {  40,   400,  1 },
+    {  45,   700,  1 },
+    {  50,  1400,  2 },
+    {  55,  2000,  2 },
+    {  60,  3500,  4 },
+    {  65,  6000,  6 },
+    {  70,  9000,  8 },
+    {  75, 13000, 10 },
+    {  80, 18000, 12 },
+    {  85, 25000, 14 },
+    {  90, 33000, 16 },
+    {  95, 42000, 18 },
+    { 100, 52000, 20 },
+};
+
+struct SiqsParams {
+    SiqsParams(int factorBaseSize=0, int blockCount=0, int largePrimeMultiplier=0) : factorBaseSize(factorBaseSize), blockCount(blockCount), largePrimeMultiplier(largePrimeMultiplier), out_multiplier(1), out_polynomialCount(0), out_fullRelationCount(0), out_combinedRelationCount(0), out_matrixSize(0), out_sieveTime(0), out_linearAlgebraTime(0) {}
+    int factorBaseSize;        // 0 - chosen from SiqsSizeParamsTable (same for blockCount)
+    int blockCount;
+    int largePrimeMultiplier;  // 0 - SiqsLargePrimeMultiplier
+    uint32_t out_multiplier;
+    uint64_t out_polynomialCount;
+    uint64_t out_fullRelationCount;
+    uint64_t out_combinedRelationCount; // relations made of two partial relations
+    uint64_t out_matrixSize;            // number of columns left for dense elimination
+    double out_sieveTime;               // in seconds
+    double out_linearAlgebraTime;
+};
+
+// parameters for a number with given number of decimal digits (interpolated between rows of the table)
+SiqsSizeParams siqsSizeParams(int digits) {
+    auto& table = SiqsSizeParamsTable;
+    if (digits <= table.front().digits) return table.front();
+    if (digits >= table.back().digits) return table.back();
+    std::size_t i = 1;
+    while (table[i].digits < digits) ++i;
+    auto& low = table[i - 1];
+    auto& high = table[i];
+    double t = double(digits - low.digits) / (high.digits - low.digits);
+    return { digits, static_cast<int>(low.factorBaseSize + t * (high.factorBaseSize - low.factorBaseSize)), high.blockCount };
+}
+
+// arithmetic modulo factor base primes (p < 2^32)
+uint32_t siqsPowMod(uint64_t base, uint64_t exponent, uint32_t p) {
+    uint64_t result = 1;
+    base %= p;
+    for (; exponent > 0; exponent >>= 1) {
+        if (exponent & 1) {
+            result = result * base % p;
+        }
+        base = base * base % p;
+    }
+    return static_cast<uint32_t>(result);
+}
+uint32_t siqsInverse(uint32_t a, uint32_t p) {
+    int64_t r0 = p, r1 = a % p;
+    int64_t t0 = 0, t1 = 1;
+    while (r1 != 0) {
+        auto q = r0 / r1;
+        std::tie(r0, r1) = std::make_pair(r1, r0 - q * r1);
+        std::tie(t0, t1) = std::make_pair(t1, t0 - q * t1);
+    }
+    return static_cast<uint32_t>(t0 < 0 ? t0 + p : t0);
+}
+// square root of a quadratic residue a (Tonelli-Shanks)
+uint32_t siqsSqrtMod(uint32_t a, uint32_t p) {
+    a %= p;
+    if (p == 2 || a == 0) {
+        return a;
+    }
+    if (p % 4 == 3) {
+        return siqsPowMod(a, (p + 1) / 4, p);
+    }
+    uint32_t q = p - 1;
+    int s = 0;
+    while (q % 2 == 0) {
+        q /= 2;
+        s += 1;
+    }
+    uint32_t z = 2;
+    while (siqsPowMod(z, (p - 1) / 2, p) != p - 1) {
+        z += 1;
+    }
+    uint64_t c = siqsPowMod(z, q, p);
+    uint64_t t = siqsPowMod(a, q, p);
+    uint64_t r = siqsPowMod(a, (q + 1) / 2, p);
+    int m = s;
+    while (t != 1) {
+        int i = 0;
+        for (uint64_t tt = t; tt != 1; tt = tt * tt % p) {
+            i += 1;
+        }
+        uint64_t b = c;
+        for (int j = 0; j < m - i - 1; ++j) {
+            b = b * b % p;
+        }
+        m = i;
+        c = b * b % p;
+        t = t * c % p;
+        r = r * b % p;
+    }
+    return static_cast<uint32_t>(r);
+}
+
+// Knuth-Schroeppel: multiplier k for which small primes divide values of x^2 - kN most often
+uint32_t siqsChooseMultiplier(const BigIntGmp& n) {
+    static constexpr uint32_t Multipliers[] = { 1, 3, 5, 7, 11, 13, 15, 17, 19, 21, 23, 29, 31, 33, 35, 37, 39, 41, 43, 47, 51, 53, 55, 57, 59, 61, 67, 69, 71, 73 };
+    constexpr int PrimeCount = 300;
+    std::vector<uint32_t> nMod(PrimeCount);
+    for (int i = 1; i < PrimeCount; ++i) {
+        nMod[i] = static_cast<uint32_t>(mpz_fdiv_ui(n.data, Primes_1_000_000[i]));
+    }
+    auto nMod8 = mpz_fdiv_ui(n.data, 8);
+    uint32_t bestMultiplier = 1;
+    double bestScore = -1e300;
+    for (auto k : Multipliers) {
+        double score = -0.5 * std::log(double(k));
+        switch (k * nMod8 % 8) {
+        case 1:         score += 2 * std::log(2.0);   break;
+        case 5:         score += std::log(2.0);       break;
+        case 3: case 7: score += 0.5 * std::log(2.0); break;
+        }
+        for (int i = 1; i < PrimeCount; ++i) {
+            uint32_t p = Primes_1_000_000[i];
+            auto kn = (k % p) * uint64_t(nMod[i]) % p;
+            if (kn == 0) {
+                score += std::log(double(p)) / p;
+            } else if (siqsPowMod(kn, (p - 1) / 2, p) == 1) {
+                score += 2 * std::log(double(p)) / (p - 1);
+            }
+        }
+        if (score > bestScore) {
+            bestScore = score;
+            bestMultiplier = k;
+        }
+    }
+    return bestMultiplier;
+}
+
+// primes p for which kN is a quadratic residue (including 2 and the primes of k)
+struct SiqsFactorBase {
+    std::vector<uint32_t> primes;
+    std::vector<uint32_t> roots; // roots[i]^2 = kN (mod primes[i])
+    std::vector<uint8_t> logs;   // rounded log2(primes[i])
+};
+// returns a prime factor of n if one is found in the factor base range (0 otherwise)
+uint32_t siqsCreateFactorBase(SiqsFactorBase& factorBase, const BigIntGmp& n, const BigIntGmp& kN, int size) {
+    for (std::size_t i = 0; factorBase.primes.size() < static_cast<std::size_t>(size) && i < Primes_1_000_000.size(); ++i) {
+        uint32_t p = Primes_1_000_000[i];
+        if (mpz_fdiv_ui(n.data, p) == 0) {
+            return p;
+        }
+        auto knMod = static_cast<uint32_t>(mpz_fdiv_ui(kN.data, p));
+        if (p != 2 && knMod != 0 && siqsPowMod(knMod, (p - 1) / 2, p) != 1) {
+            continue;
+        }
+        factorBase.primes.push_back(p);
+        factorBase.roots.push_back(siqsSqrtMod(knMod, p));
+        factorBase.logs.push_back(static_cast<uint8_t>(std::lround(std::log2(double(p)))));
+    }
+    return 0;
+}
+
+// (Ax + B)^2 = product of factors * largePrime^2 (mod n)
+struct SiqsRelation {
+    BigIntGmp y;
+    std::vector<uint32_t> factors; // matrix columns with multiplicity: 0 is -1, i + 1 is factorBase.primes[i]
+    uint64_t largePrime = 1;
+};
+
+struct SiqsPolynomial {
+    BigIntGmp A, B, C;
+    std::vector<BigIntGmp> Bl;  // B = +-B_0 +- ... + B_(s-1), B_l^2 = kN (mod q_l) and B_l = 0 (mod other q)
+    std::vector<int> aFactors;  // factor base indices of q_l, A = q_0 * ... * q_(s-1)
+    std::vector<int> signs;     // current sign of every B_l
+};
+
+// s factor base primes with product close to exp(logTarget), every set is used only once
+bool siqsChooseA(std::vector<int>& aFactors, const SiqsFactorBase& factorBase, double logTarget, std::set<std::vector<int>>& usedA) {
+    auto& primes = factorBase.primes;
+    int firstIndex = static_cast<int>(std::upper_bound(primes.begin(), primes.end(), SiqsSmallPrimeLimit) - primes.begin());
+    int s = std::max(1, static_cast<int>(std::lround(logTarget / std::log(SiqsAFactorSize))));
+    while (std::exp(logTarget / s) > primes[primes.size() * 3 / 4]) s += 1;
+    while (s > 1 && std::exp(logTarget / s) < primes[firstIndex]) s -= 1;
+    double q = std::exp(logTarget / s);
+    int low = std::max(firstIndex, static_cast<int>(std::lower_bound(primes.begin(), primes.end(), static_cast<uint32_t>(q / 1.5)) - primes.begin()));
+    int high = static_cast<int>(std::upper_bound(primes.begin(), primes.end(), static_cast<uint32_t>(q * 1.5)) - primes.begin());
+    high = std::min<int>(static_cast<int>(primes.size()), std::max(high, low + s + 8));
+    low = std::max(firstIndex, std::min(low, high - s - 8));
+
+    auto usable = [&](int index, const std::vector<int>& chosen) {
+        return index >= firstIndex && index < static_cast<int>(primes.size()) && factorBase.roots[index] != 0 && std::find(chosen.begin(), chosen.end(), index) == chosen.end();
+    };
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        std::vector<int> chosen;
+        double logProduct = 0;
+        while (static_cast<int>(chosen.size()) < s - 1) {
+            int index = random<int>(low, high - 1);
+            if (usable(index, chosen)) {
+                chosen.push_back(index);
+                logProduct += std::log(double(primes[index]));
+            }
+        }
+        // last prime makes the product closest to the target, later attempts take random ones
+        int last;
+        if (attempt < 100) {
+            auto lastValue = std::exp(logTarget - logProduct);
+            last = static_cast<int>(std::lower_bound(primes.begin(), primes.end(), static_cast<uint32_t>(std::min(lastValue, 4e9))) - primes.begin());
+            if (last == static_cast<int>(primes.size()) || (last > 0 && lastValue - primes[last - 1] < primes[last] - lastValue)) {
+                last -= 1;
+            }
+        } else {
+            last = random<int>(low, high - 1);
+        }
+        if (!usable(last, chosen)) {
+            continue;
+        }
+        chosen.push_back(last);
+        std::sort(chosen.begin(), chosen.end());
+        if (usedA.insert(chosen).second) {
+            aFactors = chosen;
+            return true;
+        }
+    }
+    return false;
+}
+
+// first polynomial for given primes of A (all signs positive)
+void siqsInitPolynomial(SiqsPolynomial& poly, const SiqsFactorBase& factorBase, const BigIntGmp& kN) {
+    auto s = poly.aFactors.size();
+    mpz_set_ui(poly.A.data, 1);
+    for (auto index : poly.aFactors) {
+        mpz_mul_ui(poly.A.data, poly.A.data, factorBase.primes[index]);
+    }
+    poly.Bl.resize(s);
+    poly.signs.assign(s, 1);
+    mpz_set_ui(poly.B.data, 0);
+    for (std::size_t l = 0; l < s; ++l) {
+        uint32_t q = factorBase.primes[poly.aFactors[l]];
+        auto& Bl = poly.Bl[l];
+        mpz_divexact_ui(Bl.data, poly.A.data, q);
+        uint64_t gamma = uint64_t(factorBase.roots[poly.aFactors[l]]) * siqsInverse(static_cast<uint32_t>(mpz_fdiv_ui(Bl.data, q)), q) % q;
+        if (gamma > q / 2) {
+            gamma = q - gamma;
+        }
+        mpz_mul_ui(Bl.data, Bl.data, gamma);
+        mpz_add(poly.B.data, poly.B.data, Bl.data);
+    }
+    mpz_mul(poly.C.data, poly.B.data, poly.B.data);
+    mpz_sub(poly.C.data, poly.C.data, kN.data);
+    debugAssert(mpz_divisible_p(poly.C.data, poly.A.data));
+    mpz_divexact(poly.C.data, poly.C.data, poly.A.data);
+}
+
+/*
+    Structured Gaussian elimination. Every row of the matrix is a set of relations (initially single ones)
+    with the set of columns that have odd exponent in their product.
+    Columns of weight 1 are removed with their row, columns of weight w <= SiqsMaxMergeWeight are removed by adding
+    their lightest row to the others (which removes one row and one column, so the excess of rows is kept),
+    and the remaining columns are eliminated as a dense bit matrix.
+    Returns sets of relations with square products.
+*/
+std::vector<std::vector<uint32_t>> siqsFindDependencies(const std::vector<SiqsRelation>& relations, uint32_t columnCount, uint64_t& denseColumnCount) {
+    struct Row {
+        std::vector<uint32_t> columns;
+        std::vector<uint32_t> relations;
+        bool isRemoved = false;
+    };
+    auto symmetricDifference = [](std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+        std::vector<uint32_t> result;
+        std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+        a = std::move(result);
+    };
+
+    std::vector<Row> rows(relations.size());
+    std::vector<std::vector<uint32_t>> columnRows(columnCount);
+    for (uint32_t r = 0; r < relations.size(); ++r) {
+        auto factors = relations[r].factors;
+        std::sort(factors.begin(), factors.end());
+        for (std::size_t i = 0; i < factors.size(); ++i) {
+            if (i + 1 < factors.size() && factors[i] == factors[i + 1]) {
+                i += 1;
+            } else {
+                rows[r].columns.push_back(factors[i]);
+                columnRows[factors[i]].push_back(r);
+            }
+        }
+        rows[r].relations = { r };
+    }
+
+    // column lists can contain removed rows and rows which no longer have the column
+    auto compactColumn = [&](uint32_t column) -> std::vector<uint32_t>& {
+        auto& list = columnRows[column];
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t r) {
+            return rows[r].isRemoved || !std::binary_search(rows[r].columns.begin(), rows[r].columns.end(), column);
+        }), list.end());
+        return list;
+    };
+    for (int maxWeight = 1; maxWeight <= SiqsMaxMergeWeight; ++maxWeight) {
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (uint32_t column = 0; column < columnCount; ++column) {
+                if (columnRows[column].empty()) {
+                    continue;
+                }
+                auto& list = compactColumn(column);
+                if (list.empty() || list.size() > static_cast<std::size_t>(maxWeight)) {
+                    continue;
+                }
+                auto pivot = *std::min_element(list.begin(), list.end(), [&](uint32_t a, uint32_t b) { return rows[a].columns.size() < rows[b].columns.size(); });
+                for (auto r : list) {
+                    if (r == pivot) {
+                        continue;
+                    }
+                    symmetricDifference(rows[r].columns, rows[pivot].columns);
+                    symmetricDifference(rows[r].relations, rows[pivot].relations);
+                    for (auto c : rows[pivot].columns) {
+                        if (std::binary_search(rows[r].columns.begin(), rows[r].columns.end(), c)) {
+                            columnRows[c].push_back(r);
+                        }
+                    }
+                }
+                rows[pivot].isRemoved = true;
+                list.clear();
+                changed = true;
+            }
+        }
+    }
+
+    // dense elimination: bit matrix with a row per remaining column and a column per remaining row
+    std::vector<uint32_t> rowIds;
+    for (uint32_t r = 0; r < rows.size(); ++r) {
+        if (!rows[r].isRemoved) {
+            rowIds.push_back(r);
+        }
+    }
+    std::vector<int> columnIndex(columnCount, -1);
+    int denseRowCount = 0;
+    for (auto r : rowIds) {
+        for (auto c : rows[r].columns) {
+            if (columnIndex[c] < 0) {
+                columnIndex[c] = denseRowCount++;
+            }
+        }
+    }
+    denseColumnCount = denseRowCount;
+    std::size_t words = (rowIds.size() + 63) / 64;
+    std::vector<uint64_t> matrix(denseRowCount * words);
+    for (std::size_t j = 0; j < rowIds.size(); ++j) {
+        for (auto c : rows[rowIds[j]].columns) {
+            matrix[columnIndex[c] * words + j / 64] |= 1ull << (j % 64);
+        }
+    }
+    auto bit = [&](int i, std::size_t j) { return (matrix[i * words + j / 64] >> (j % 64)) & 1; };
+    std::vector<std::size_t> pivotColumns;
+    std::vector<std::size_t> freeColumns;
+    int rank = 0;
+    for (std::size_t j = 0; j < rowIds.size(); ++j) {
+        int pivot = rank;
+        while (pivot < denseRowCount && !bit(pivot, j)) {
+            pivot += 1;
+        }
+        if (pivot == denseRowCount) {
+            freeColumns.push_back(j);
+            if (freeColumns.size() == SiqsExcessRelations) {
+                break;
+            }
+            continue;
+        }
+        std::swap_ranges(matrix.begin() + pivot * words, matrix.begin() + (pivot + 1) * words, matrix.begin() + rank * words);
+        for (int i = 0; i < denseRowCount; ++i) {
+            if (i != rank && bit(i, j)) {
+                for (std::size_t w = 0; w < words; ++w) {
+                    matrix[i * words + w] ^= matrix[rank * words + w];
+                }
+            }
+        }
+        pivotColumns.push_back(j);
+        rank += 1;
+    }
+
+    // null space vector for every free column f: x_f = 1 and x_(pivot of row i) = M[i][f]
+    std::vector<std::vector<uint32_t>> dependencies;
+    for (auto f : freeColumns) {
+        std::vector<uint32_t> dependency = rows[rowIds[f]].relations;
+        for (int i = 0; i < rank; ++i) {
+            if (bit(i, f)) {
+                symmetricDifference(dependency, rows[rowIds[pivotColumns[i]]].relations);
+            }
+        }
+        if (!dependency.empty()) {
+            dependencies.push_back(std::move(dependency));
+        }
+    }
+    return dependencies;
+}
+
+// gcd(X - Y, n) where X^2 = Y^2 (mod n) comes from the product of relations of the dependency
+BigIntGmp siqsSquareRoot(const BigIntGmp& n, const std::vector<SiqsRelation>& relations, const std::vector<uint32_t>& dependency, const SiqsFactorBase& factorBase) {
+    BigIntGmp x = 1, y = 1, power, factor;
+    std::vector<uint32_t> exponents(factorBase.primes.size() + 1, 0);
+    for (auto r : dependency) {
+        auto& relation = relations[r];
+        mpz_mul(x.data, x.data, relation.y.data);
+        mpz_mod(x.data, x.data, n.data);
+        mpz_mul_ui(y.data, y.data, relation.largePrime);
+        mpz_mod(y.data, y.data, n.data);
+        for (auto column : relation.factors) {
+            exponents[column] += 1;
+        }
+    }
+    for (std::size_t column = 1; column < exponents.size(); ++column) {
+        debugAssert(exponents[column] % 2 == 0);
+        if (exponents[column] > 0) {
+            mpz_ui_pow_ui(power.data, factorBase.primes[column - 1], exponents[column] / 2);
+            mpz_mul(y.data, y.data, power.data);
+            mpz_mod(y.data, y.data, n.data);
+        }
+    }
+    mpz_sub(x.data, x.data, y.data);
+    mpz_gcd(factor.data, x.data, n.data);
+    return factor;
+}
+
+// returns a non-trivial factor of n, or 1 if none was found
+BigIntGmp siqs(SiqsParams& params, const BigIntGmp& n) {
+    BigIntGmp one = 1;
+    BigIntGmp factor;
+    auto bitCount = mpz_sizeinbase(n.data, 2);
+    for (unsigned long e = 2; e <= bitCount / 16; ++e) {
+        if (mpz_root(factor.data, n.data, e)) {
+            return factor;
+        }
+    }
+    auto sizeParams = siqsSizeParams(static_cast<int>(mpz_sizeinbase(n.data, 10)));
+    if (params.factorBaseSize == 0) params.factorBaseSize = sizeParams.factorBaseSize;
+    if (params.blockCount == 0) params.blockCount = sizeParams.blockCount;
+    if (params.largePrimeMultiplier == 0) params.largePrimeMultiplier = SiqsLargePrimeMultiplier;
+    params.out_polynomialCount = 0;
+    params.out_fullRelationCount = 0;
+    params.out_combinedRelationCount = 0;
+    params.out_matrixSize = 0;
+    params.out_sieveTime = 0;
+    params.out_linearAlgebraTime = 0;
+    auto sieveStart = std::chrono::steady_clock::now();
+
+    uint32_t k = siqsChooseMultiplier(n);
+    params.out_multiplier = k;
+    BigIntGmp kN;
+    mpz_mul_ui(kN.data, n.data, k);
+    SiqsFactorBase factorBase;
+    if (auto p = siqsCreateFactorBase(factorBase, n, kN, params.factorBaseSize)) {
+        return BigIntGmp{ p };
+    }
+    auto& primes = factorBase.primes;
+    auto& roots = factorBase.roots;
+    auto& logs = factorBase.logs;
+    int primeCount = static_cast<int>(primes.size());
+    int firstSievedIndex = static_cast<int>(std::upper_bound(primes.begin(), primes.end(), SiqsSmallPrimeLimit) - primes.begin());
+
+    uint32_t intervalSize = params.blockCount * SiqsBlockSize;
+    uint32_t M = intervalSize / 2;
+    uint64_t largePrimeBound = uint64_t(params.largePrimeMultiplier) * primes.back();
+    // |g(x)| <= M * sqrt(kN / 2); candidates may miss the large prime and contributions of primes that are not sieved
+    double logMax = std::log2(double(M)) + 0.5 * (mpz_sizeinbase(kN.data, 2) - 1);
+    double smallPrimeLogs = 1;
+    for (int i = 1; i < firstSievedIndex; ++i) {
+        smallPrimeLogs += 2 * std::log2(double(primes[i])) / (primes[i] - 1);
+    }
+    auto threshold = static_cast<uint8_t>(std::max(1.0, logMax - std::log2(double(largePrimeBound)) - smallPrimeLogs - SiqsThresholdMargin));
+    // a byte can reach the threshold only if it has one of these bits set
+    uint64_t scanMask = 0x0101010101010101ull * (~(mostSignificantBit(threshold) - 1) & 0xFF);
+    double logTarget = 0.5 * std::log(2 * mpz_get_d(kN.data)) - std::log(double(M));
+
+    std::vector<SiqsRelation> relations;
+    std::unordered_map<uint64_t, SiqsRelation> partialRelations;
+    std::set<std::vector<int>> usedA;
+    std::size_t requiredRelations = primeCount + 1 + SiqsExcessRelations;
+
+    SiqsPolynomial poly;
+    std::vector<uint32_t> aInverse(primeCount), root1(primeCount), root2(primeCount), next1(primeCount), next2(primeCount);
+    std::vector<uint8_t> isSkipped(primeCount); // primes of A and k are not sieved, they are checked by division instead
+    std::vector<std::vector<uint32_t>> deltas;  // 2 * B_l / A (mod p)
+    std::vector<uint8_t> sieve(SiqsBlockSize);
+    BigIntGmp g, y, bTimes2;
+    SiqsRelation relation;
+
+    auto trialDivide = [&](uint32_t j) {
+        int64_t x = int64_t(j) - M;
+        mpz_mul_si(y.data, poly.A.data, x);
+        mpz_add(y.data, y.data, poly.B.data);
+        mpz_mul_2exp(bTimes2.data, poly.B.data, 1);
+        mpz_mul_si(g.data, poly.A.data, x);
+        mpz_add(g.data, g.data, bTimes2.data);
+        mpz_mul_si(g.data, g.data, x);
+        mpz_add(g.data, g.data, poly.C.data);
+        relation.factors.clear();
+        if (mpz_sgn(g.data) < 0) {
+            relation.factors.push_back(0);
+            mpz_neg(g.data, g.data);
+        }
+        if (mpz_sgn(g.data) == 0) {
+            return;
+        }
+        auto twos = mpz_scan1(g.data, 0);
+        mpz_tdiv_q_2exp(g.data, g.data, twos);
+        relation.factors.insert(relation.factors.end(), twos, 1);
+        for (auto index : poly.aFactors) {
+            relation.factors.push_back(index + 1);
+        }
+        for (int i = 1; i < primeCount; ++i) {
+            uint32_t p = primes[i];
+            if (!isSkipped[i]) {
+                auto r = j % p;
+                if (r != root1[i] && r != root2[i]) {
+                    continue;
+                }
+            }
+            while (mpz_divisible_ui_p(g.data, p)) {
+                mpz_divexact_ui(g.data, g.data, p);
+                relation.factors.push_back(i + 1);
+            }
+        }
+        if (mpz_cmp_ui(g.data, 1) == 0) {
+            mpz_mod(relation.y.data, y.data, n.data);
+            relation.largePrime = 1;
+            relations.push_back(relation);
+            params.out_fullRelationCount += 1;
+        } else if (mpz_fits_ulong_p(g.data) && mpz_get_ui(g.data) < largePrimeBound) {
+            uint64_t largePrime = mpz_get_ui(g.data);
+            mpz_mod(relation.y.data, y.data, n.data);
+            auto it = partialRelations.find(largePrime);
+            if (it == partialRelations.end()) {
+                partialRelations.emplace(largePrime, relation);
+                return;
+            }
+            // (y1 y2)^2 = factors1 * factors2 * largePrime^2
+            auto& other = it->second;
+            if (mpz_cmp(other.y.data, relation.y.data) == 0) {
+                return;
+            }
+            mpz_mul(relation.y.data, relation.y.data, other.y.data);
+            mpz_mod(relation.y.data, relation.y.data, n.data);
+            relation.factors.insert(relation.factors.end(), other.factors.begin(), other.factors.end());
+            relation.largePrime = largePrime;
+            relations.push_back(relation);
+            params.out_combinedRelationCount += 1;
+        }
+    };
+
+    auto sievePolynomial = [&]() {
+        params.out_polynomialCount += 1;
+        for (int i = firstSievedIndex; i < primeCount; ++i) {
+            next1[i] = root1[i];
+            next2[i] = root2[i];
+        }
+        for (uint32_t blockStart = 0; blockStart < intervalSize; blockStart += SiqsBlockSize) {
+            uint32_t blockEnd = blockStart + SiqsBlockSize;
+            std::fill(sieve.begin(), sieve.end(), 0);
+            for (int i = firstSievedIndex; i < primeCount; ++i) {
+                if (isSkipped[i]) {
+                    continue;
+                }
+                uint32_t p = primes[i];
+                uint8_t logp = logs[i];
+                uint32_t a = next1[i];
+                uint32_t b = next2[i];
+                for (; a < blockEnd; a += p) sieve[a - blockStart] += logp;
+                for (; b < blockEnd; b += p) sieve[b - blockStart] += logp;
+                next1[i] = a;
+                next2[i] = b;
+            }
+            for (uint32_t w = 0; w < SiqsBlockSize; w += 8) {
+                uint64_t word;
+                std::memcpy(&word, &sieve[w], 8);
+                if ((word & scanMask) == 0) {
+                    continue;
+                }
+                for (uint32_t j = w; j < w + 8; ++j) {
+                    if (sieve[j] >= threshold) {
+                        trialDivide(blockStart + j);
+                    }
+                }
+            }
+        }
+    };
+
+    while (true) {
+        while (relations.size() < requiredRelations) {
+            if (!siqsChooseA(poly.aFactors, factorBase, logTarget, usedA)) {
+                return one;
+            }
+            siqsInitPolynomial(poly, factorBase, kN);
+            auto s = poly.aFactors.size();
+            deltas.assign(s, std::vector<uint32_t>(primeCount));
+            for (int i = 1; i < primeCount; ++i) {
+                uint32_t p = primes[i];
+                isSkipped[i] = roots[i] == 0 || std::find(poly.aFactors.begin(), poly.aFactors.end(), i) != poly.aFactors.end();
+                if (isSkipped[i]) {
+                    continue;
+                }
+                aInverse[i] = siqsInverse(static_cast<uint32_t>(mpz_fdiv_ui(poly.A.data, p)), p);
+                for (std::size_t l = 0; l < s; ++l) {
+                    deltas[l][i] = static_cast<uint32_t>(2 * mpz_fdiv_ui(poly.Bl[l].data, p) * aInverse[i] % p);
+                }
+                // x = (+-t - B) / A, shifted by M to index in [0, 2M)
+                uint64_t bMod = mpz_fdiv_ui(poly.B.data, p);
+                uint64_t mMod = M % p;
+                root1[i] = static_cast<uint32_t>(((roots[i] + p - bMod) % p * aInverse[i] + mMod) % p);
+                root2[i] = static_cast<uint32_t>(((2 * p - roots[i] - bMod) % p * aInverse[i] + mMod) % p);
+            }
+            sievePolynomial();
+            // Gray code over signs of B_0 ... B_(s-2)
+            for (uint64_t polyIndex = 1; polyIndex < (1ull << (s - 1)) && relations.size() < requiredRelations; ++polyIndex) {
+                auto l = trailingZeroBitCount(polyIndex);
+                auto& delta = deltas[l];
+                if (poly.signs[l] > 0) {
+                    mpz_submul_ui(poly.B.data, poly.Bl[l].data, 2);
+                    for (int i = 1; i < primeCount; ++i) {
+                        uint32_t p = primes[i];
+                        root1[i] += delta[i]; if (root1[i] >= p) root1[i] -= p;
+                        root2[i] += delta[i]; if (root2[i] >= p) root2[i] -= p;
+                    }
+                } else {
+                    mpz_addmul_ui(poly.B.data, poly.Bl[l].data, 2);
+                    for (int i = 1; i < primeCount; ++i) {
+                        uint32_t p = primes[i];
+                        root1[i] += (root1[i] < delta[i]) ? p - delta[i] : -delta[i];
+                        root2[i] += (root2[i] < delta[i]) ? p - delta[i] : -delta[i];
+                    }
+                }
+                poly.signs[l] = -poly.signs[l];
+                mpz_mul(poly.C.data, poly.B.data, poly.B.data);
+                mpz_sub(poly.C.data, poly.C.data, kN.data);
+                mpz_divexact(poly.C.data, poly.C.data, poly.A.data);
+                sievePolynomial();
+            }
+        }
+        params.out_sieveTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - sieveStart).count();
+
+        auto linearAlgebraStart = std::chrono::steady_clock::now();
+        auto dependencies = siqsFindDependencies(relations, primeCount + 1, params.out_matrixSize);
+        for (auto& dependency : dependencies) {
+            factor = siqsSquareRoot(n, relations, dependency, factorBase);
+            if (factor != one && factor != n) {
+                params.out_linearAlgebraTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - linearAlgebraStart).count();
+                return factor;
+            }
+        }
+        params.out_linearAlgebraTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - linearAlgebraStart).count();
+        // all dependencies were trivial (unlikely), collect more relations
+        sieveStart = std::chrono::steady_clock::now();
+        requiredRelations = relations.size() + SiqsExcessRelations;
+    }
+}
+BigInt siqs(SiqsParams& params, const BigInt& n) {
+    BigInt factor = siqs(params, n.visit([](auto&& a) { return BigIntGmp{ a.mod }; }));
+    factor.fitToSize();
+    return factor;
+}
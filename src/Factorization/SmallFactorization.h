@@ -0,0 +1,236 @@
+#pragma once
+#include "TrialDivision.h"
+#include "../BigInt/64bitIntrinsics.h"
+#include "../Utility/bitManipulation.h"
+#include <cstdint>
+#include <cmath>
+#include <numeric>
+#include <array>
+
+/*
+    Factorization of 1-limb numbers below 2^SmallFactorMaxBits on plain uint64_t:
+    - Lehman's method, O(n^(1/3)), but with a very small constant,
+    - Hart's one line factoring with multiplier 480 (s^2 - 480*i*n is a square much more often than s^2 - i*n),
+    - SQUFOF, O(n^(1/4)), with 16 multipliers racing (their iterations are interleaved and the first
+      multiplier that finds a proper square wins, which avoids the long cycles of unlucky multipliers).
+    smallFactor chooses the method by the size of n: Hart is the fastest up to about 36 bits, SQUFOF above that
+    (measured on balanced semiprimes). Lehman is slower than both, but it always finds a factor, so it is the
+    fallback when they fail. Products that don't fit in 64 bits use mul128, values that are known to be small
+    are computed modulo 2^64.
+*/
+constexpr int SmallFactorMaxBits = 62;
+constexpr int LehmanMaxBits = 42;
+constexpr int HartMaxBits = 36;
+constexpr uint64_t HartMaxIterCount = 1 << 17;
+constexpr uint64_t SmallFactorTrialDivisionBound = 1 << 10;
+
+// floor(sqrt(high * 2^64 + low)) for values below 2^126
+uint64_t isqrt(uint64_t high, uint64_t low) {
+    auto r = static_cast<uint64_t>(std::sqrt(std::ldexp(double(high), 64) + double(low)));
+    auto isAbove = [&](uint64_t x) {
+        uint64_t h, l;
+        mul128(h, l, x, x);
+        return h > high || (h == high && l > low);
+    };
+    while (r > 0 && isAbove(r)) --r;
+    while (!isAbove(r + 1)) ++r;
+    return r;
+}
+uint64_t isqrt(uint64_t n) {
+    return isqrt(0, n);
+}
+
+template<uint32_t Modulus> constexpr std::array<bool, Modulus> squaresModulo() {
+    std::array<bool, Modulus> isSquare{};
+    for (uint32_t i = 0; i < Modulus; ++i) {
+        isSquare[i * i % Modulus] = true;
+    }
+    return isSquare;
+}
+// residues modulo 64, 63 and 65 reject over 99% of non-squares before the square root is computed
+bool isSquare(uint64_t n, uint64_t& root) {
+    static constexpr auto SquaresMod64 = squaresModulo<64>();
+    static constexpr auto SquaresMod63 = squaresModulo<63>();
+    static constexpr auto SquaresMod65 = squaresModulo<65>();
+    if (!SquaresMod64[n % 64] || !SquaresMod63[n % 63] || !SquaresMod65[n % 65]) {
+        return false;
+    }
+    root = isqrt(n);
+    return root * root == n;
+}
+
+// Lehman's method for n below 2^LehmanMaxBits: divisors up to n^(1/3) are checked by trial division,
+// then a^2 - 4kn = b^2 is searched for k <= n^(1/3) and sqrt(4kn) <= a <= sqrt(4kn) + n^(1/6) / (4 sqrt(k)).
+// Returns 1 if n is prime.
+uint64_t lehman(uint64_t n) {
+    auto cubeRoot = static_cast<uint64_t>(std::cbrt(double(n)));
+    while (cubeRoot * cubeRoot * cubeRoot > n) --cubeRoot;
+    while ((cubeRoot + 1) * (cubeRoot + 1) * (cubeRoot + 1) <= n) ++cubeRoot;
+    auto trialResult = trialDivision(n, cubeRoot + 1);
+    if (trialResult != n) {
+        return trialResult;
+    }
+    double sixthRoot = std::sqrt(double(cubeRoot + 1));
+    for (uint64_t k = 1; k <= cubeRoot; ++k) {
+        uint64_t fourKn = 4 * k * n;
+        double sqrtFourKn = std::sqrt(double(fourKn));
+        auto a = static_cast<uint64_t>(sqrtFourKn);
+        while (a * a < fourKn) ++a;
+        auto aMax = static_cast<uint64_t>(sqrtFourKn + sixthRoot / (4 * std::sqrt(double(k))));
+        // for odd k both a and b are even, and a/2 is odd exactly when kn = 1 (mod 4)
+        uint64_t step = 1;
+        if (k % 2 == 1) {
+            step = 4;
+            uint64_t residue = (k * n) % 4 == 1 ? 2 : 0;
+            a += (residue + 4 - a % 4) % 4;
+        }
+        for (; a <= aMax; a += step) {
+            uint64_t b;
+            if (isSquare(a * a - fourKn, b)) {
+                return std::gcd(a + b, n);
+            }
+        }
+    }
+    return 1;
+}
+
+// Hart's one line factoring: s = ceil(sqrt(480 * i * n)), if s^2 - 480 * i * n = t^2 then gcd(s - t, n) is usually a factor.
+// n must be below 2^55. Returns 1 if no factor was found in maxIterCount iterations.
+uint64_t hartOneLine(uint64_t n, uint64_t maxIterCount) {
+    constexpr uint64_t Multiplier = 480;
+    uint64_t nm = n * Multiplier;
+    double sqrtNm = std::sqrt(double(nm));
+    uint64_t nmi = 0; // 480 * i * n modulo 2^64, enough as s^2 - 480 * i * n is small
+    for (uint64_t i = 1; i <= maxIterCount; ++i) {
+        nmi += nm;
+        auto s = static_cast<uint64_t>(std::ceil(sqrtNm * std::sqrt(double(i))));
+        uint64_t m = s * s - nmi;
+        if (static_cast<int64_t>(m) < 0) {
+            // square root was rounded down
+            m += 2 * s + 1;
+            s += 1;
+        }
+        uint64_t t;
+        if (isSquare(m, t)) {
+            auto factor = std::gcd(s - t, n);
+            if (factor > 1 && factor < n) {
+                return factor;
+            }
+        }
+    }
+    return 1;
+}
+
+// continued fraction expansion of sqrt(k * n) for SQUFOF. Values of P and Q stay below 2 sqrt(kn) < 2^38,
+// so kn is only needed modulo 2^64 (and its square root).
+struct SqufofState {
+    SqufofState() {}
+    SqufofState(uint64_t n, uint64_t k) : k(k) {
+        uint64_t high;
+        mul128(high, kn, k, n);
+        s = static_cast<int64_t>(isqrt(high, kn));
+        P = s;
+        previousQ = 1;
+        Q = static_cast<int64_t>(kn - uint64_t(s) * uint64_t(s));
+        // the expected number of iterations is about sqrt(2 sqrt(kn))
+        maxIterCount = 6 * static_cast<uint64_t>(std::sqrt(2.0 * s));
+        isActive = Q != 0;
+    }
+    uint64_t k = 1;
+    uint64_t kn = 0;
+    int64_t s = 0; // floor(sqrt(kn))
+    int64_t P = 0;
+    int64_t Q = 0;
+    int64_t previousQ = 0;
+    uint64_t iterCount = 0;
+    uint64_t maxIterCount = 0;
+    bool isActive = false;
+};
+
+// finds the symmetry point of the cycle that starts at the square form with Q = r^2, returns gcd of its Q and n
+uint64_t squfofReverseCycle(const SqufofState& state, int64_t r, uint64_t n) {
+    int64_t b = (state.s - state.P) / r;
+    int64_t P = b * r + state.P;
+    int64_t previousQ = r;
+    int64_t Q = static_cast<int64_t>((state.kn - uint64_t(P) * uint64_t(P)) / uint64_t(r));
+    if (Q == 0) {
+        return 1;
+    }
+    for (uint64_t i = 0; i < state.maxIterCount; ++i) {
+        b = (state.s + P) / Q;
+        int64_t nextP = b * Q - P;
+        int64_t nextQ = previousQ + b * (P - nextP);
+        previousQ = Q;
+        Q = nextQ;
+        if (nextP == P) {
+            break;
+        }
+        P = nextP;
+    }
+    return std::gcd(uint64_t(previousQ), n);
+}
+
+// SQUFOF with racing multipliers. n must be odd, not a square, have no factors up to 11 and be below 2^62.
+// Returns 1 if all multipliers failed.
+uint64_t squfof(uint64_t n) {
+    static constexpr uint64_t Multipliers[] = { 1, 3, 5, 7, 11, 3*5, 3*7, 3*11, 5*7, 5*11, 7*11, 3*5*7, 3*5*11, 3*7*11, 5*7*11, 3*5*7*11 };
+    constexpr int MultiplierCount = sizeof(Multipliers) / sizeof(Multipliers[0]);
+    constexpr int IterationsPerTurn = 32;
+    std::array<SqufofState, MultiplierCount> states;
+    for (int i = 0; i < MultiplierCount; ++i) {
+        states[i] = SqufofState(n, Multipliers[i]);
+    }
+    for (int activeCount = MultiplierCount; activeCount > 0;) {
+        activeCount = 0;
+        for (auto& state : states) {
+            if (!state.isActive) {
+                continue;
+            }
+            for (int i = 0; i < IterationsPerTurn; ++i) {
+                int64_t b = (state.s + state.P) / state.Q;
+                int64_t nextP = b * state.Q - state.P;
+                int64_t nextQ = state.previousQ + b * (state.P - nextP);
+                state.previousQ = state.Q;
+                state.Q = nextQ;
+                state.P = nextP;
+                state.iterCount += 1;
+                // proper square forms are only at even indices, Q is Q_(iterCount + 1) now
+                uint64_t r;
+                if (state.iterCount % 2 == 1 && isSquare(uint64_t(state.Q), r)) {
+                    auto factor = squfofReverseCycle(state, static_cast<int64_t>(r), n);
+                    if (factor > 1 && factor < n) {
+                        return factor;
+                    }
+                }
+            }
+            state.isActive = state.iterCount < state.maxIterCount;
+            activeCount += state.isActive;
+        }
+    }
+    return 1;
+}
+
+// non-trivial factor of a composite n below 2^SmallFactorMaxBits, or 1 if none was found
+uint64_t smallFactor(uint64_t n) {
+    debugAssert(n < (1ull << SmallFactorMaxBits));
+    auto trialResult = trialDivision(n, SmallFactorTrialDivisionBound);
+    if (trialResult != n) {
+        return trialResult;
+    }
+    uint64_t root;
+    if (isSquare(n, root)) {
+        return root;
+    }
+    auto bitCount = sizeInBits(n);
+    if (bitCount <= HartMaxBits) {
+        auto factor = hartOneLine(n, HartMaxIterCount);
+        if (factor != 1) {
+            return factor;
+        }
+    }
+    auto factor = squfof(n);
+    if (factor == 1 && bitCount <= LehmanMaxBits) {
+        return lehman(n);
+    }
+    return factor;
+}
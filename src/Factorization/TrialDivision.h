@@ -2,6 +2,8 @@
 #include "../PrecomputedTables/primeTable.h"
 #include "../Utility/generalUtils.h"
 #include "../Utility/avx2.h"
+#include "../Utility/avx512.h"
+#include "../Utility/cpuFeatures.h"
 #include "../Utility/compilerMacros.h"
 #include "../BigInt/include.h"
 #include <vector>
@@ -13,6 +15,28 @@
 
 constexpr uint64_t MaxIntegerDouble = 1ull << 53;
 
+// bit i is set if i-th element of the divisors vector divides n
+class AvxDividesResult {
+    uint32_t laneMask;
+public:
+    AvxDividesResult() {}
+    AvxDividesResult(uint32_t laneMask) : laneMask(laneMask) {}
+    operator bool() { return laneMask; }
+    template<int Index> bool get() {
+        return laneMask & (1u << Index);
+    }
+    int firstLane() {
+        return static_cast<int>(trailingZeroBitCount(laneMask));
+    }
+};
+bool divides(double n, uint64_t div) {
+    return n == div * std::floor(n / div);
+}
+bool divides(uint64_t n, uint64_t div) {
+    return n % div == 0;
+}
+
+TARGET_AVX2_BEGIN
 __m256d my256RemDoubleZeroMask(const AvxType<double>& a, const AvxType<double>& b) {
     return a == b * avx::floor(a / b);
 }
@@ -48,40 +72,43 @@ AvxType<uint64_t> Rem256_64(const AvxType<uint64_t>& a, const AvxType<uint64_t>&
     auto res = _mm256_add_pd(_mm256_mul_pd(highModB, cstModB), lowModB);
     return _mm256_castpd_si256(my256RemDoubleZeroMask(res, bLow));
 }
-
-class AvxDividesResult {
-    uint32_t value;
-public:
-    AvxDividesResult() {}
-    AvxDividesResult(uint32_t value) : value(value) {}
-    operator bool() { return value; }
-    template<int Index> bool get() {
-        if constexpr (Index == 0) return value & 0x000000ff;
-        if constexpr (Index == 1) return value & 0x0000ff00;
-        if constexpr (Index == 2) return value & 0x00ff0000;
-        if constexpr (Index == 3) return value & 0xff000000;
-        return false;
-    }
-};
 AvxDividesResult divides(const AvxType<double>& a, const AvxType<double>& b, const AvxType<double>& bInverse) {
-    return AvxDividesResult{ avx::mask8bit(a == b * avx::floor(a * bInverse)) };
+    return AvxDividesResult{ avx::laneMask(a == b * avx::floor(a * bInverse)) };
 }
 AvxDividesResult divides(const AvxType<double>& a, const AvxType<double>& b) {
-    return AvxDividesResult{ avx::mask8bit(a == b * avx::floor(a / b)) };
+    return AvxDividesResult{ avx::laneMask(a == b * avx::floor(a / b)) };
 }
 AvxDividesResult divides(const AvxType<uint64_t>& a, const AvxType<uint64_t>& b) {
-    return AvxDividesResult{ avx::mask8bit(Rem256_64(a, b)) };
+    return AvxDividesResult{ avx::laneMask(Rem256_64(a, b)) };
 }
-bool divides(double n, uint64_t div) {
-    return n == div * std::floor(n / div);
+TARGET_END
+
+TARGET_AVX512_BEGIN
+Avx512Type<double> my512RemDouble(const Avx512Type<double>& a, const Avx512Type<double>& b) {
+    return a - b * avx512::floor(a / b);
 }
-bool divides(uint64_t n, uint64_t div) {
-    return n % div == 0;
+// same as Rem256_64, returns mask of elements for which a % b == 0 (b < 2^32)
+uint32_t rem512ZeroMask(const Avx512Type<uint64_t>& a, const Avx512Type<uint64_t>& b) {
+    auto aHigh = avx512::toDouble<uint64_t>(_mm512_maskz_srli_epi64(0xFF, a, 12));
+    auto aLow = avx512::toDouble<uint64_t>(_mm512_and_si512(a, _mm512_set1_epi64(4095)));
+    auto bDouble = avx512::toDouble(b);
+    auto res = my512RemDouble(aHigh, bDouble) * my512RemDouble(avx512::setElements<double>(4096), bDouble) + my512RemDouble(aLow, bDouble);
+    return avx512::equal(res, bDouble * avx512::floor(res / bDouble));
+}
+AvxDividesResult divides(const Avx512Type<double>& a, const Avx512Type<double>& b, const Avx512Type<double>& bInverse) {
+    return AvxDividesResult{ avx512::equal(a, b * avx512::floor(a * bInverse)) };
+}
+AvxDividesResult divides(const Avx512Type<double>& a, const Avx512Type<double>& b) {
+    return AvxDividesResult{ avx512::equal(a, b * avx512::floor(a / b)) };
 }
+AvxDividesResult divides(const Avx512Type<uint64_t>& a, const Avx512Type<uint64_t>& b) {
+    return AvxDividesResult{ rem512ZeroMask(a, b) };
+}
+TARGET_END
 
 namespace TrialDivisionOption {
     enum {
-        UseAvx = 1,
+        UseAvx = 1, // widest vector instructions supported by the CPU
         UseTable = 2,
         UseWheel = 4,
         UseBound = 8,
@@ -89,14 +116,150 @@ namespace TrialDivisionOption {
     };
 }
 
+// instruction set used by trial division with UseAvx option, chosen once at startup
+enum class TrialDivisionSimd { None, Avx2, Avx512 };
+TrialDivisionSimd detectTrialDivisionSimd() {
+    if (CurrentCpuFeatures.avx512f && CurrentCpuFeatures.avx512dq) return TrialDivisionSimd::Avx512;
+    if (CurrentCpuFeatures.avx2) return TrialDivisionSimd::Avx2;
+    return TrialDivisionSimd::None;
+}
+const TrialDivisionSimd CurrentTrialDivisionSimd = detectTrialDivisionSimd();
+
 #define IsAvx ((Options & TrialDivisionOption::UseAvx) != 0)
 #define IsTable ((Options & TrialDivisionOption::UseTable) != 0)
 #define IsWheel ((Options & TrialDivisionOption::UseWheel) != 0)
 #define HasBound ((Options & TrialDivisionOption::UseBound) != 0)
 
 template<typename T, int Options = TrialDivisionOption::UseAll>
-uint64_t trialDivisionSingle(T n, uint64_t& biggestFactorChecked, std::size_t& currentTableEntryId, std::size_t& wheelIndex, const T* primes, uint64_t bound) {
+uint64_t trialDivisionSingle(T n, uint64_t& biggestFactorChecked, std::size_t& currentTableEntryId, std::size_t& wheelIndex, const T* primes, uint64_t bound);
+
+TARGET_AVX2_BEGIN
+template<typename T, int Options>
+uint64_t trialDivisionAvx2(T n, T sqrtN, uint64_t& biggestFactorChecked, std::size_t& currentTableEntryId, std::size_t& wheelIndex, const T* primes, uint64_t bound) {
+    const double* mulInverses = MultiplicativeInversesDouble.data();
+    auto nVec = avx::setElements<T>(n);
+    [[maybe_unused]] auto wheelInc = avx::setElements<T>(12, 12, 16, 14);
+    bool wheelIncState = 0;
+    auto factorVec = IsTable
+        ? avx::load(&primes[currentTableEntryId])
+        : IsWheel
+            ? avx::setElements<T>((T)biggestFactorChecked, (T)biggestFactorChecked+4, (T)biggestFactorChecked+6, (T)biggestFactorChecked+10)
+            : avx::setElements<T>((T)biggestFactorChecked, (T)biggestFactorChecked+1, (T)biggestFactorChecked+2, (T)biggestFactorChecked+3);
+    [[maybe_unused]] auto factorVecInverses = avx::load(&mulInverses[currentTableEntryId]);
+    
+    // NOTE: Possibly one could gain significant speed-up by unrolling this loop
+    while ((IsTable && primes[currentTableEntryId] <= sqrtN) || avx::getElement<0>(factorVec) <= sqrtN) {
+        AvxDividesResult divisors;
+        if constexpr (IsTable && std::is_same_v<T, double>) {
+            divisors = divides(nVec, factorVec, factorVecInverses);
+        } else {
+            divisors = divides(nVec, factorVec);
+        }
+        if (divisors) {
+            biggestFactorChecked = (uint64_t)avx::getElement<0>(factorVec);
+            if (divisors.template get<0>()) return (uint64_t)avx::getElement<0>(factorVec);
+            if (divisors.template get<1>()) return (uint64_t)avx::getElement<1>(factorVec);
+            if (divisors.template get<2>()) return (uint64_t)avx::getElement<2>(factorVec);
+            if (divisors.template get<3>()) return (uint64_t)avx::getElement<3>(factorVec);
+        } else {
+            if constexpr (IsTable) {
+                currentTableEntryId += 4;
+                if (currentTableEntryId + 4 > 1'000'000) {
+                    biggestFactorChecked = 15'485'827;
+                    return trialDivisionSingle<T, Options>(n, biggestFactorChecked, currentTableEntryId, wheelIndex, primes, bound);
+                }
+                if (HasBound) biggestFactorChecked = static_cast<uint64_t>(primes[currentTableEntryId-1]);
+                factorVec = avx::load(primes + currentTableEntryId);
+                factorVecInverses = avx::load(mulInverses + currentTableEntryId);
+            } else if constexpr (IsWheel) {
+                factorVec = factorVec + wheelInc;
+                if (wheelIncState) {
+                    wheelInc = avx::setElements<T>(12, 12, 16, 14);
+                    if (HasBound) biggestFactorChecked += 18;
+                } else {
+                    wheelInc = avx::setElements<T>(18, 18, 14, 16);
+                    if (HasBound) biggestFactorChecked += 12;
+                }
+                wheelIncState = !wheelIncState;
+            } else {
+                factorVec = factorVec + avx::setElements<T>(4);
+                if (HasBound) biggestFactorChecked += 4;
+            }
+            if (HasBound) {
+                if (biggestFactorChecked >= bound) {
+                    biggestFactorChecked = (uint64_t)avx::getElement<0>(factorVec); // TODO: its not fully accurate
+                    return (uint64_t)n; // n is coprime to all numbers below given bound
+                }
+            }
+        }
+    }
+    return (uint64_t)n; // n is prime
+}
+TARGET_END
+
+TARGET_AVX512_BEGIN
+// same as trialDivisionAvx2 with 8 factors at once (whole 30-wheel period in wheel mode)
+template<typename T, int Options>
+uint64_t trialDivisionAvx512(T n, T sqrtN, uint64_t& biggestFactorChecked, std::size_t& currentTableEntryId, std::size_t& wheelIndex, const T* primes, uint64_t bound) {
+    if (IsTable && currentTableEntryId + 8 > 1'000'000) {
+        return trialDivisionAvx2<T, Options>(n, sqrtN, biggestFactorChecked, currentTableEntryId, wheelIndex, primes, bound);
+    }
     const double* mulInverses = MultiplicativeInversesDouble.data();
+    auto nVec = avx512::setElements<T>(n);
+    auto b = (T)biggestFactorChecked;
+    auto factorVec = IsTable
+        ? avx512::load(&primes[currentTableEntryId])
+        : IsWheel
+            ? avx512::setElements<T>(b, b+4, b+6, b+10, b+12, b+16, b+22, b+24)
+            : avx512::setElements<T>(b, b+1, b+2, b+3, b+4, b+5, b+6, b+7);
+    auto factorVecInverses = avx512::zero<double>();
+    if constexpr (IsTable) {
+        factorVecInverses = avx512::load(&mulInverses[currentTableEntryId]);
+    }
+
+    while (avx512::getElement<0>(factorVec) <= sqrtN) {
+        AvxDividesResult divisors;
+        if constexpr (IsTable && std::is_same_v<T, double>) {
+            divisors = divides(nVec, factorVec, factorVecInverses);
+        } else {
+            divisors = divides(nVec, factorVec);
+        }
+        if (divisors) {
+            biggestFactorChecked = (uint64_t)avx512::getElement<0>(factorVec);
+            return (uint64_t)avx512::getElement(factorVec, divisors.firstLane());
+        }
+        if constexpr (IsTable) {
+            currentTableEntryId += 8;
+            if (currentTableEntryId + 8 > 1'000'000) {
+                if (currentTableEntryId + 4 <= 1'000'000) {
+                    return trialDivisionAvx2<T, Options>(n, sqrtN, biggestFactorChecked, currentTableEntryId, wheelIndex, primes, bound);
+                }
+                biggestFactorChecked = 15'485'827;
+                return trialDivisionSingle<T, Options>(n, biggestFactorChecked, currentTableEntryId, wheelIndex, primes, bound);
+            }
+            if (HasBound) biggestFactorChecked = static_cast<uint64_t>(primes[currentTableEntryId-1]);
+            factorVec = avx512::load(primes + currentTableEntryId);
+            factorVecInverses = avx512::load(mulInverses + currentTableEntryId);
+        } else if constexpr (IsWheel) {
+            factorVec = factorVec + avx512::setElements<T>(30);
+            if (HasBound) biggestFactorChecked += 30;
+        } else {
+            factorVec = factorVec + avx512::setElements<T>(8);
+            if (HasBound) biggestFactorChecked += 8;
+        }
+        if (HasBound) {
+            if (biggestFactorChecked >= bound) {
+                biggestFactorChecked = (uint64_t)avx512::getElement<0>(factorVec);
+                return (uint64_t)n; // n is coprime to all numbers below given bound
+            }
+        }
+    }
+    return (uint64_t)n; // n is prime
+}
+TARGET_END
+
+template<typename T, int Options>
+uint64_t trialDivisionSingle(T n, uint64_t& biggestFactorChecked, std::size_t& currentTableEntryId, std::size_t& wheelIndex, const T* primes, uint64_t bound) {
     if (IsTable && currentTableEntryId > 999'996)
         return trialDivisionSingle<T, Options & ~TrialDivisionOption::UseTable>(n, biggestFactorChecked, currentTableEntryId, wheelIndex, primes, bound);
     if (biggestFactorChecked < 7) {
@@ -108,61 +271,13 @@ uint64_t trialDivisionSingle(T n, uint64_t& biggestFactorChecked, std::size_t& c
     }
     T sqrtN = (T)std::ceil(std::sqrt(n));
     if constexpr (IsAvx) {
-        auto nVec = avx::setElements<T>(n);
-        [[maybe_unused]] auto wheelInc = avx::setElements<T>(12, 12, 16, 14);
-        bool wheelIncState = 0;
-        auto factorVec = IsTable
-            ? avx::load(&primes[currentTableEntryId])
-            : IsWheel
-                ? avx::setElements<T>((T)biggestFactorChecked, (T)biggestFactorChecked+4, (T)biggestFactorChecked+6, (T)biggestFactorChecked+10)
-                : avx::setElements<T>((T)biggestFactorChecked, (T)biggestFactorChecked+1, (T)biggestFactorChecked+2, (T)biggestFactorChecked+3);
-        [[maybe_unused]] auto factorVecInverses = avx::load(&mulInverses[currentTableEntryId]);
-        
-        // NOTE: Possibly one could gain significant speed-up by unrolling this loop
-        while ((IsTable && primes[currentTableEntryId] <= sqrtN) || avx::getElement<0>(factorVec) <= sqrtN) {
-            AvxDividesResult divisors;
-            if constexpr (IsTable && std::is_same_v<T, double>) {
-                divisors = divides(nVec, factorVec, factorVecInverses);
-            } else {
-                divisors = divides(nVec, factorVec);
-            }
-            if (divisors) {
-                biggestFactorChecked = (uint64_t)avx::getElement<0>(factorVec);
-                if (divisors.template get<0>()) return (uint64_t)avx::getElement<0>(factorVec);
-                if (divisors.template get<1>()) return (uint64_t)avx::getElement<1>(factorVec);
-                if (divisors.template get<2>()) return (uint64_t)avx::getElement<2>(factorVec);
-                if (divisors.template get<3>()) return (uint64_t)avx::getElement<3>(factorVec);
-            } else {
-                if constexpr (IsTable) {
-                    currentTableEntryId += 4;
-                    if (currentTableEntryId + 4 > 1'000'000) {
-                        biggestFactorChecked = 15'485'827;
-                        return trialDivisionSingle<T, Options>(n, biggestFactorChecked, currentTableEntryId, wheelIndex, primes, bound);
-                    }
-                    if (HasBound) biggestFactorChecked = static_cast<uint64_t>(primes[currentTableEntryId-1]);
-                    factorVec = avx::load(primes + currentTableEntryId);
-                    factorVecInverses = avx::load(mulInverses + currentTableEntryId);
-                } else if constexpr (IsWheel) {
-                    factorVec = factorVec + wheelInc;
-                    if (wheelIncState) {
-                        wheelInc = avx::setElements<T>(12, 12, 16, 14);
-                        if (HasBound) biggestFactorChecked += 18;
-                    } else {
-                        wheelInc = avx::setElements<T>(18, 18, 14, 16);
-                        if (HasBound) biggestFactorChecked += 12;
-                    }
-                    wheelIncState = !wheelIncState;
-                } else {
-                    factorVec = factorVec + avx::setElements<T>(4);
-                    if (HasBound) biggestFactorChecked += 4;
-                }
-                if (HasBound) {
-                    if (biggestFactorChecked >= bound) {
-                        biggestFactorChecked = (uint64_t)avx::getElement<0>(factorVec); // TODO: its not fully accurate
-                        return (uint64_t)n; // n is coprime to all numbers below given bound
-                    }
-                }
-            }
+        switch (CurrentTrialDivisionSimd) {
+        case TrialDivisionSimd::Avx512:
+            return trialDivisionAvx512<T, Options>(n, sqrtN, biggestFactorChecked, currentTableEntryId, wheelIndex, primes, bound);
+        case TrialDivisionSimd::Avx2:
+            return trialDivisionAvx2<T, Options>(n, sqrtN, biggestFactorChecked, currentTableEntryId, wheelIndex, primes, bound);
+        default:
+            return trialDivisionSingle<T, Options & ~TrialDivisionOption::UseAvx>(n, biggestFactorChecked, currentTableEntryId, wheelIndex, primes, bound);
         }
     } else {
         biggestFactorChecked = IsTable ? primes[currentTableEntryId] : biggestFactorChecked;
@@ -2,9 +2,17 @@
 
 #include "Ecm/ecm.h"
 #include "TrialDivision.h"
+#include "BatchTrialDivision.h"
 #include "PollardRho.h"
+#include "PollardRhoLanes.h"
+#include "SmallFactorization.h"
 #include "Pminus1.h"
+#include "QuadraticSieve.h"
 #include "../PrimalityTesting/isProbablyPrime.h"
+#include "../PrimalityTesting/batchPrimality.h"
+#include "../Utility/threadPool.h"
+#include <span>
+#include <chrono>
 
 std::vector<std::pair<uint64_t, uint64_t>> B1_Curve_Pairs = {
 	{     1629,    10}, // 40
@@ -18,11 +26,40 @@ std::vector<std::pair<uint64_t, uint64_t>> B1_Curve_Pairs = {
 	{ 35158748,  6076}, // 160
 	{491130495, 29584}, // 200
 };
+// ECM stage 2 bound is EcmB2PerB1 * B1, but at most EcmMaxB2 (stage 2 plan takes about B2/80 bytes)
+const uint64_t EcmB2PerB1 = 50;
+const uint64_t EcmMaxB2 = 2'000'000'000;
+const uint64_t PMinus1B2PerB1 = 100;
+const uint64_t PMinus1MaxB2 = 10'000'000'000;
+const uint64_t PMinus1FftMinB2 = 100'000'000; // polynomial stage 2 is faster than baby-step giant-step from about this B2
+// ECM uses Edwards curves with NAF, Montgomery curves with PRAC took the same time on 64-450 bit semiprimes
+// numbers from SiqsMinBits (~40 digits) are factored with SIQS, which is much faster than ECM for balanced semiprimes.
+// Below SiqsDirectBits (~60 digits) ECM first runs up to B1=SiqsEcmMaxB1, as it finds small factors faster than SIQS.
+const int SiqsMinBits = 130;
+const int SiqsDirectBits = 196;
+const uint64_t SiqsEcmMaxB1 = 12322;
+// 1-limb numbers below 2^SmallFactorBits are factored with SQUFOF/Hart/Lehman, from there Pollard rho is faster
+const int SmallFactorBits = 44;
+// factorBatch divides out primes up to this bound from all inputs at once, before factoring them one by one
+const uint64_t FactorBatchTrialDivisionBound = 1 << 16;
 
-std::vector<BigInt> factor(BigInt n, bool writeDebug=false) {
+// threadCount - number of threads ECM can distribute its curves to
+std::vector<BigInt> factor(BigInt n, bool writeDebug=false, int threadCount=1) {
 	if (writeDebug) writeln("Started factorization of ", n);
 	std::vector<BigInt> factors;
 	BigInt factor;
+	// SQUFOF/Hart/Lehman, Pollard rho, P-1, ECM and SIQS may return a composite factor, which is factored recursively
+	auto addFactor = [&](const BigInt& f) {
+		n /= f;
+		if (isProbablyPrime(f)) {
+			factors.emplace_back(f);
+		} else {
+			if (writeDebug) writeln("Factor=", f, " is composite, factoring it");
+			auto subFactors = ::factor(f, writeDebug, threadCount);
+			factors.insert(factors.end(), subFactors.begin(), subFactors.end());
+		}
+		if (writeDebug) writeln("Found factor=", f, ". Remaining number=", n);
+	};
 	while (true) {
 		if (isProbablyPrime(n, factor, writeDebug)) {
 			factors.emplace_back(n);
@@ -36,24 +73,99 @@ std::vector<BigInt> factor(BigInt n, bool writeDebug=false) {
 			continue;
 		}
 		
+		if (n.IsType<BigIntFixedSize<1>>() && n.sizeInBits() < SmallFactorBits) {
+			if (writeDebug) writeln("Running SQUFOF/Hart/Lehman...");
+			auto smallResult = smallFactor(n.get<BigIntFixedSize<1>>()[0]);
+			if (smallResult != 1) {
+				addFactor(BigInt{ smallResult });
+				continue;
+			}
+		}
 		PollardRhoParams pollardRhoParams(0, 1'000'000);
 		if (writeDebug) writeln("Running Pollard Rho with max iteration count=", pollardRhoParams.maxIterCount, "...");
-		factor = pollardRhoBrent(pollardRhoParams, n);
-		for (int i = 0; factor.isOne() && i < B1_Curve_Pairs.size(); ++i) {
+		if (BigIntLanesAreVectorized && n.IsType<BigIntFixedSize<1>>() && n.sizeInBits() <= PollardRhoLanesMaxBits) {
+			factor = pollardRhoBrentLanes(pollardRhoParams, n.get<BigIntFixedSize<1>>()[0]);
+		} else {
+			factor = pollardRhoBrent(pollardRhoParams, n);
+		}
+		auto runPMinus1AndEcm = [&](std::size_t i) {
 			auto B1 = B1_Curve_Pairs[i].first;
 			auto curveCount = B1_Curve_Pairs[i].second;
-			EcmContext ecmContext(EcmMulMethod::Naf, EcmMulCascadeMethod::Seperate, B1, B1, curveCount);
+			auto B2 = std::max(B1, std::min(EcmB2PerB1 * B1, EcmMaxB2));
+			EcmContext ecmContext(EcmMulMethod::Naf, EcmMulCascadeMethod::Seperate, B1, B2, curveCount);
+			ecmContext.threadCount = threadCount;
 
-			if (writeDebug) writeln("Running P-1 with B1=", ecmContext.B1, "; B2=", ecmContext.B2, "...");
-			factor = pMinus1(n, ecmContext.B1, ecmContext.B2);
-			if (!factor.isOne())
-				break;
+			PMinus1Params pMinus1Params(B1, std::max(B1, std::min(PMinus1B2PerB1 * B1, PMinus1MaxB2)));
+			pMinus1Params.useFftStage2 = pMinus1Params.B2 >= PMinus1FftMinB2;
+			if (writeDebug) writeln("Running P-1 with B1=", pMinus1Params.B1, "; B2=", pMinus1Params.B2, "...");
+			auto result = pMinus1(pMinus1Params, n);
+			if (!result.isOne())
+				return result;
 
 			if (writeDebug) writeln("Running ECM with B1=", ecmContext.B1, "; B2=", ecmContext.B2, "; L=", ecmContext.curveCount, "...");
-			factor = ecm(ecmContext, EllipticCurveForm::TwistedEdwards, n);
+			return ecm(ecmContext, EllipticCurveForm::TwistedEdwards, n);
+		};
+		bool useSiqs = n.sizeInBits() >= SiqsMinBits;
+		std::size_t i = 0;
+		for (; factor.isOne() && i < B1_Curve_Pairs.size(); ++i) {
+			if (useSiqs && (n.sizeInBits() >= SiqsDirectBits || B1_Curve_Pairs[i].first > SiqsEcmMaxB1))
+				break;
+			factor = runPMinus1AndEcm(i);
+		}
+		if (factor.isOne() && useSiqs) {
+			SiqsParams siqsParams;
+			if (writeDebug) writeln("Running SIQS...");
+			factor = siqs(siqsParams, n);
+			if (writeDebug) writeln("SIQS used multiplier=", siqsParams.out_multiplier, "; factor base size=", siqsParams.factorBaseSize, "; polynomials=", siqsParams.out_polynomialCount, "; matrix size=", siqsParams.out_matrixSize);
+		}
+		// SIQS fails only for unexpected inputs (for example when it runs out of polynomials), ECM is the fallback
+		for (; factor.isOne() && i < B1_Curve_Pairs.size(); ++i) {
+			factor = runPMinus1AndEcm(i);
 		}
-		factors.emplace_back(factor);
-		n /= factor;
-		if (writeDebug) writeln("Found factor=", factor, ". Remaining number=", n);
+		addFactor(factor);
+	}
+}
+
+struct FactorBatchResult {
+	std::vector<BigInt> factors;
+	double seconds = 0; // time spent factoring this input
+};
+
+// Factors all numbers using the global work-stealing pool. Small prime factors of all inputs are found together with
+// batch trial division, and the cofactors are tested for primality together as well. Then every input is a separate
+// task, and ECM of every input splits its curves into tasks of the same pool, so idle threads help with the inputs
+// that take longest (waiting for a group runs only tasks of that group, so this does not oversubscribe).
+// Results are in the same order as the input.
+std::vector<FactorBatchResult> factorBatch(std::span<const BigInt> numbers) {
+	std::vector<FactorBatchResult> results(numbers.size());
+	auto& pool = globalThreadPool();
+	int ecmThreadCount = pool.concurrency();
+	static const BatchTrialDivisionPrimes trialDivisionPrimes(FactorBatchTrialDivisionBound);
+	auto trialDivisionResults = batchTrialDivision(trialDivisionPrimes, numbers);
+	std::vector<BigInt> cofactors;
+	cofactors.reserve(numbers.size());
+	for (auto& trialDivisionResult : trialDivisionResults) {
+		cofactors.emplace_back(std::move(trialDivisionResult.cofactor));
+		cofactors.back().fitToSize();
+	}
+	auto cofactorIsPrime = batchIsProbablyPrime(cofactors);
+	TaskGroup group;
+	for (std::size_t i = 0; i < numbers.size(); ++i) {
+		pool.run(group, [&, i] {
+			auto start = std::chrono::steady_clock::now();
+			auto& factors = results[i].factors;
+			for (auto p : trialDivisionResults[i].factors) {
+				factors.emplace_back(p);
+			}
+			if (cofactorIsPrime[i]) {
+				factors.emplace_back(cofactors[i]);
+			} else if (!cofactors[i].isOne() || factors.empty()) { // factor(1) = { 1 }
+				auto cofactorFactors = factor(cofactors[i], false, ecmThreadCount);
+				factors.insert(factors.end(), cofactorFactors.begin(), cofactorFactors.end());
+			}
+			results[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		});
 	}
+	pool.wait(group);
+	return results;
 }
@@ -0,0 +1,141 @@
+#pragma once
+#include "../PrecomputedTables/primeSieve.h"
+#include "../Utility/bitManipulation.h"
+#include <cstdint>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+/*
+    Baby-step giant-step stage 2 (shared by ECM and P-1). Every prime q in (B1, B2] is written as q = g*D +- j,
+    where 0 < j < D/2 and gcd(j, D) = 1. Both methods compare values derived from giant step g*D and baby step j
+    that are equal for g*D - j and g*D + j at once, so one multiplication covers a pair of primes.
+*/
+struct Stage2Plan {
+    uint64_t B1 = 0;
+    uint64_t B2 = 0;
+    uint64_t D = 0;
+    std::vector<int> babySteps; // all j in (0, D/2) coprime to D
+    uint64_t firstGiant = 0;
+    uint64_t giantCount = 0;
+    int maskWords = 0;          // number of 64-bit words in mask of baby steps
+};
+
+// plan without any giant steps, for when there is no stage 2 (B2 <= B1) or B1 is too small for any D
+Stage2Plan emptyStage2Plan(uint64_t B1, uint64_t B2) {
+    Stage2Plan plan;
+    plan.B1 = B1;
+    plan.B2 = B2;
+    return plan;
+}
+
+// plan with given D (D has to be even and its prime factors cannot be bigger than B1)
+Stage2Plan createStage2Plan(uint64_t B1, uint64_t B2, uint64_t D) {
+    Stage2Plan plan;
+    plan.B1 = B1;
+    plan.B2 = B2;
+    plan.D = D;
+    for (uint64_t j = 1; j < D / 2; j += 2) {
+        if (std::gcd(j, D) == 1) {
+            plan.babySteps.emplace_back(static_cast<int>(j));
+        }
+    }
+    plan.firstGiant = std::max<uint64_t>(1, (B1 + 1) / D);
+    plan.giantCount = (B2 + D / 2) / D - plan.firstGiant + 1;
+    plan.maskWords = static_cast<int>((plan.babySteps.size() + 63) / 64);
+    return plan;
+}
+
+// D minimizes the number of steps: D/4 baby steps and (B2-B1)/D giant steps (D/2 <= B1 so that all primes are coprime to D)
+Stage2Plan createStage2Plan(uint64_t B1, uint64_t B2) {
+    if (B2 <= B1) {
+        return emptyStage2Plan(B1, B2);
+    }
+    uint64_t range = B2 - B1;
+    uint64_t bestD = 0;
+    uint64_t bestCost = MaxU64;
+    for (uint64_t D : { 6, 30, 210 }) {
+        if (D / 2 <= B1 && D / 4 + range / D < bestCost) {
+            bestCost = D / 4 + range / D;
+            bestD = D;
+        }
+    }
+    for (uint64_t D = 2310; D / 2 <= B1 && D / 4 < bestCost; D += 2310) {
+        if (D / 4 + range / D < bestCost) {
+            bestCost = D / 4 + range / D;
+            bestD = D;
+        }
+    }
+    if (bestD == 0) {
+        return emptyStage2Plan(B1, B2);
+    }
+    return createStage2Plan(B1, B2, bestD);
+}
+
+// Plan for stage 2 with polynomial evaluation: the product tree of baby steps is built once (with inverses for
+// the remainder tree), which costs about 3 times as much as babySteps.size() giant steps,
+// and then giant steps cost O(log^2) each. D is the primorial that minimizes the estimated cost.
+Stage2Plan createPolynomialStage2Plan(uint64_t B1, uint64_t B2) {
+    if (B2 <= B1) {
+        return emptyStage2Plan(B1, B2);
+    }
+    // primorial, its biggest prime factor and number of baby steps (phi(D)/2)
+    constexpr uint64_t Primorials[][3] = { {6, 3, 1}, {30, 5, 4}, {210, 7, 24}, {2310, 11, 240}, {30030, 13, 2880}, {510510, 17, 46080} };
+    uint64_t range = B2 - B1;
+    uint64_t bestD = 0;
+    uint64_t bestCost = MaxU64;
+    for (auto [D, biggestPrime, babyCount] : Primorials) {
+        auto cost = 3 * babyCount + range / D;
+        if (biggestPrime <= B1 && cost < bestCost) {
+            bestCost = cost;
+            bestD = D;
+        }
+    }
+    if (bestD == 0) {
+        return emptyStage2Plan(B1, B2);
+    }
+    return createStage2Plan(B1, B2, bestD);
+}
+
+// Calls function(giantIndex, mask) for every giant step in order (until it returns false), where bit b of mask is set
+// if (firstGiant + giantIndex)*D +- babySteps[b] is a prime in (B1, B2]. Primes are streamed from PrimeSieve.
+template<typename Function> void forEachStage2Giant(const Stage2Plan& plan, Function function) {
+    if (plan.giantCount == 0) {
+        return;
+    }
+    auto D = plan.D;
+    std::vector<int> babyIndex(D / 2, -1);
+    for (std::size_t b = 0; b < plan.babySteps.size(); ++b) {
+        babyIndex[plan.babySteps[b]] = static_cast<int>(b);
+    }
+    std::vector<uint64_t> mask(plan.maskWords);
+    uint64_t giantIndex = 0;
+    // q = g*D +- j with j < D/2 (j != D/2 as D/2 is not coprime to D), so giant step of q is the nearest multiple of D
+    for (auto q : PrimeSieve(plan.B1 + 1, plan.B2)) {
+        uint64_t qGiantIndex = (q + D / 2) / D - plan.firstGiant;
+        for (; giantIndex < qGiantIndex; ++giantIndex) {
+            if (!function(giantIndex, static_cast<const uint64_t*>(mask.data()))) {
+                return;
+            }
+            std::fill(mask.begin(), mask.end(), 0);
+        }
+        uint64_t giant = (plan.firstGiant + qGiantIndex) * D;
+        auto b = babyIndex[q > giant ? q - giant : giant - q];
+        mask[b / 64] |= 1ull << (b % 64);
+    }
+    for (; giantIndex < plan.giantCount; ++giantIndex) {
+        if (!function(giantIndex, static_cast<const uint64_t*>(mask.data()))) {
+            return;
+        }
+        std::fill(mask.begin(), mask.end(), 0);
+    }
+}
+
+// calls function(b) for every set bit b of mask
+template<typename Function> void forEachStage2Pair(const Stage2Plan& plan, const uint64_t* mask, Function function) {
+    for (int w = 0; w < plan.maskWords; ++w) {
+        for (uint64_t bits = mask[w]; bits != 0; bits &= bits - 1) {
+            function(64 * w + static_cast<int>(trailingZeroBitCount(bits)));
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+#include "primeTable.h"
+#include "../Utility/bitManipulation.h"
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+/*
+    Streaming segmented sieve of Eratosthenes: primes in [low, high] in increasing order, without an upper limit
+    on high (Primes_1_000_000 ends at 15'485'863).
+    Only numbers coprime to 30 are stored (the same 30-wheel as makePrimeArray, one bit per number, 8 numbers
+    per byte), and one segment fits in L1 cache. Memory use does not depend on the size of the range, only
+    the sieving primes up to sqrt(high) are kept, and a segment is never larger than the range itself.
+    Ranges within Primes_1_000_000 are read directly from the table.
+
+        for (auto p : PrimeSieve(low, high)) { ... }
+*/
+struct PrimeSieve {
+    static constexpr uint64_t SegmentBytes = 32 * 1024; // at most 30 * SegmentBytes numbers per segment
+    static constexpr std::array<uint8_t, 8> WheelOffsets = { 1, 7, 11, 13, 17, 19, 23, 29 };
+
+    PrimeSieve(uint64_t low, uint64_t high) : low(low), high(high) {
+        if (high <= Primes_1_000_000.back()) {
+            useTable = true;
+            tableIndex = std::lower_bound(Primes_1_000_000.begin(), Primes_1_000_000.end(), low) - Primes_1_000_000.begin();
+            return;
+        }
+        for (uint64_t p : { 2, 3, 5 }) {
+            if (low <= p && p <= high) {
+                smallPrimes.push_back(static_cast<uint32_t>(p));
+            }
+        }
+        if (high < 7) {
+            segmentStart = high + 1;
+            return;
+        }
+        uint64_t sqrtHigh = static_cast<uint64_t>(std::sqrt(static_cast<double>(high)));
+        while (sqrtHigh * sqrtHigh > high) --sqrtHigh;
+        while ((sqrtHigh + 1) * (sqrtHigh + 1) <= high) ++sqrtHigh;
+        if (sqrtHigh <= Primes_1_000_000.back()) {
+            for (std::size_t i = 3; Primes_1_000_000[i] <= sqrtHigh; ++i) {
+                sievingPrimes.push_back(Primes_1_000_000[i]);
+            }
+        } else {
+            for (auto p : PrimeSieve(7, sqrtHigh)) {
+                sievingPrimes.push_back(static_cast<uint32_t>(p));
+            }
+        }
+        segmentStart = low / 30 * 30;
+        // multiple of 8 bytes, primes are collected a word at a time
+        uint64_t segmentBytes = std::min(SegmentBytes, (high - segmentStart) / 30 + 1);
+        segmentBytes = (segmentBytes + 7) / 8 * 8;
+        segment.resize(segmentBytes);
+        primes.resize(8 * segmentBytes);
+    }
+
+    // next prime in [low, high], 0 after the last one
+    uint64_t next() {
+        if (useTable) {
+            if (tableIndex < Primes_1_000_000.size() && Primes_1_000_000[tableIndex] <= high) {
+                return Primes_1_000_000[tableIndex++];
+            }
+            return 0;
+        }
+        if (smallPrimeIndex < smallPrimes.size()) {
+            return smallPrimes[smallPrimeIndex++];
+        }
+        while (primeIndex == primeCount) {
+            if (segmentStart > high) {
+                return 0;
+            }
+            sieveSegment();
+        }
+        return primes[primeIndex++];
+    }
+
+    struct Iterator {
+        PrimeSieve* sieve;
+        uint64_t value;
+        uint64_t operator*() const { return value; }
+        Iterator& operator++() { value = sieve->next(); return *this; }
+        bool operator!=(const Iterator& other) const { return value != other.value; }
+    };
+    Iterator begin() { return { this, next() }; }
+    Iterator end()   { return { this, 0 }; }
+
+private:
+    // multiples of a sieving prime p coprime to 30 are p*q for q coprime to 30; for every residue of q mod 30
+    // they are p bytes apart and always use the same bit, so each prime has 8 independent streams
+    struct SievingPrime {
+        uint32_t p;
+        std::array<uint32_t, 8> offsets; // of the next multiple, in bytes from start of the current segment
+        std::array<uint8_t, 8> masks;
+    };
+
+    void activateSievingPrime(uint32_t p) {
+        static constexpr std::array<int8_t, 30> BitIndex = { -1, 0, -1, -1, -1, -1, -1, 1, -1, -1, -1, 2, -1, 3, -1, -1, -1, 4, -1, 5, -1, -1, -1, 6, -1, -1, -1, -1, -1, 7 };
+        SievingPrime sievingPrime;
+        sievingPrime.p = p;
+        uint64_t firstMultiplier = std::max<uint64_t>(p, (segmentStart + p - 1) / p);
+        for (int k = 0; k < 8; ++k) {
+            uint64_t q = firstMultiplier + (WheelOffsets[k] + 30 - firstMultiplier % 30) % 30;
+            uint64_t multiple = p * q;
+            sievingPrime.offsets[k] = static_cast<uint32_t>(multiple / 30 - segmentStart / 30);
+            sievingPrime.masks[k] = static_cast<uint8_t>(1u << BitIndex[multiple % 30]);
+        }
+        activePrimes.push_back(sievingPrime);
+    }
+
+    // sieves next segment and collects its primes
+    void sieveSegment() {
+        std::fill(segment.begin(), segment.end(), 0);
+        uint64_t segmentBytes = segment.size();
+        uint64_t segmentEnd = segmentStart + 30 * segmentBytes;
+        // primes start sieving at p^2, so they are added only when a segment reaches it
+        while (activatedCount < sievingPrimes.size() && static_cast<uint64_t>(sievingPrimes[activatedCount]) * sievingPrimes[activatedCount] < segmentEnd) {
+            activateSievingPrime(sievingPrimes[activatedCount++]);
+        }
+        for (auto& sievingPrime : activePrimes) {
+            for (int k = 0; k < 8; ++k) {
+                uint64_t offset = sievingPrime.offsets[k];
+                auto mask = sievingPrime.masks[k];
+                for (; offset < segmentBytes; offset += sievingPrime.p) {
+                    segment[offset] |= mask;
+                }
+                sievingPrime.offsets[k] = static_cast<uint32_t>(offset - segmentBytes);
+            }
+        }
+        if (segmentStart == 0) {
+            segment[0] |= 1; // 1 is not a prime
+        }
+        // 8 bytes (240 numbers) at once, bit b of a word is number 30 * (b / 8) + WheelOffsets[b % 8]
+        static constexpr auto BitOffsets = [] {
+            std::array<uint8_t, 64> offsets{};
+            for (int b = 0; b < 64; ++b) {
+                offsets[b] = static_cast<uint8_t>(30 * (b / 8) + WheelOffsets[b % 8]);
+            }
+            return offsets;
+        }();
+        std::size_t count = 0;
+        for (uint64_t i = 0; i < segmentBytes; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, &segment[i], 8);
+            uint64_t base = segmentStart + 30 * i;
+            for (word = ~word; word != 0; word &= word - 1) {
+                primes[count++] = base + BitOffsets[trailingZeroBitCount(word)];
+            }
+        }
+        // only first and last segment can contain numbers outside of [low, high]
+        primeIndex = std::lower_bound(primes.begin(), primes.begin() + count, low) - primes.begin();
+        primeCount = std::upper_bound(primes.begin() + primeIndex, primes.begin() + count, high) - primes.begin();
+        segmentStart = segmentEnd;
+    }
+
+    uint64_t low;
+    uint64_t high;
+    bool useTable = false;
+    std::size_t tableIndex = 0;
+    std::vector<uint32_t> smallPrimes;
+    std::size_t smallPrimeIndex = 0;
+    std::vector<uint32_t> sievingPrimes;
+    std::size_t activatedCount = 0;
+    std::vector<SievingPrime> activePrimes;
+    std::vector<uint8_t> segment;
+    uint64_t segmentStart = 0;
+    std::vector<uint64_t> primes; // primes of the last sieved segment are primes[primeIndex..primeCount)
+    std::size_t primeIndex = 0;
+    std::size_t primeCount = 0;
+};
@@ -4,8 +4,14 @@
 #include <array>
 #include <cmath>
 #include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <string>
 #include "../BigInt/64bitIntrinsics.h"
 #include "../Utility/generalUtils.h"
+#include "../Utility/bitManipulation.h"
+#include "tableFile.h"
 
 int getWheelNumber(int i) {
     constexpr std::array<int, 8> wheelAcc = { 0, 4, 6, 10, 12, 16, 22, 24 };
@@ -68,14 +74,134 @@ void savePrimeArrayToFile(const std::string& fileName, const std::vector<uint32_
     std::ofstream file(fileName, std::ios::binary);
     file.write((const char*)arr.data(), arr.size() * sizeof(uint32_t));
 }
-std::vector<uint32_t> loadPrimeArrayFromFile(const std::string& fileName, int size) {
-    std::ifstream file(fileName, std::ios::binary);
-    std::vector<uint32_t> primes;
-    primes.resize(size);
-    file.read((char*)primes.data(), primes.size() * sizeof(uint32_t));
-    return primes;
+
+// m such that floor(a / d) = floor(a * m / 2^(64 + l)) (with l = floor(log2(d)))
+uint64_t getInverse(uint64_t d) {
+    uint64_t l = sizeInBits(d);
+    if (bitSetCount(d) == 1) {
+        l -= 1;
+    }
+    uint64_t x[2];
+    x[1] = (1ull << l) - d;
+    x[0] = 0;
+    auto m = div128(x[1], x[0], d);
+    return m + 1;
 }
 
-static const auto Primes_1_000_000 = loadPrimeArrayFromFile("Primes_1_000_000.dat", 1'000'000);
-static const auto Primes64_1_000_000 = makePrimeArray<uint64_t>(Primes_1_000_000);
-static const auto PrimesDouble64_1_000_000 = makePrimeArray<double>(Primes_1_000_000);
+/*
+    Tables indexed by index of the prime (first million primes), stored in one versioned table file
+    which is memory mapped on first use, so that processes do not read or convert anything at startup
+    and share the pages. If the file is missing or has other version, tables are generated in memory
+    and saved to the file for next runs.
+    File name can be changed with PRECOMPUTED_TABLES_FILE environment variable.
+*/
+constexpr uint32_t PrecomputedTablesVersion = 1;
+constexpr std::size_t PrecomputedTablesPrimeCount = 1'000'000;
+constexpr int PowerModTableSize = 7; // 2^64k mod p for k = 1..7
+
+enum PrecomputedTableId : uint32_t {
+    PrimesTableId = 1,
+    Primes64TableId,
+    PrimesDoubleTableId,
+    MultiplicativeInversesTableId,
+    MultiplicativeInversesDoubleTableId,
+    PowerModTableId,
+};
+
+struct PrecomputedTables {
+    TableFile file;
+    const uint32_t* primes = nullptr;
+    const uint64_t* primes64 = nullptr;
+    const double* primesDouble = nullptr;
+    const uint64_t* multiplicativeInverses = nullptr;
+    const double* multiplicativeInversesDouble = nullptr;
+    const uint32_t* powerMod = nullptr;
+
+    bool assignSections() {
+        auto count = PrecomputedTablesPrimeCount;
+        primes = file.section<uint32_t>(PrimesTableId, count);
+        primes64 = file.section<uint64_t>(Primes64TableId, count);
+        primesDouble = file.section<double>(PrimesDoubleTableId, count);
+        multiplicativeInverses = file.section<uint64_t>(MultiplicativeInversesTableId, count);
+        multiplicativeInversesDouble = file.section<double>(MultiplicativeInversesDoubleTableId, count);
+        powerMod = file.section<uint32_t>(PowerModTableId, count * PowerModTableSize);
+        return primes && primes64 && primesDouble && multiplicativeInverses && multiplicativeInversesDouble && powerMod;
+    }
+};
+
+std::vector<uint8_t> createPrecomputedTablesContents() {
+    auto primes = makePrimeArray();
+    auto primes64 = makePrimeArray<uint64_t>(primes);
+    auto primesDouble = makePrimeArray<double>(primes);
+    std::vector<uint64_t> inverses(primes.size());
+    std::vector<double> inversesDouble(primes.size());
+    std::vector<uint32_t> powerMod(primes.size() * PowerModTableSize);
+    for (std::size_t i = 0; i < primes.size(); ++i) {
+        uint32_t d = primes[i];
+        inverses[i] = getInverse(d);
+        double m = 1.0 / d;
+        if (d * m < 1.0) {
+            m += m * std::numeric_limits<double>::epsilon();
+        }
+        inversesDouble[i] = m;
+        uint32_t val1 = (MaxU64 % d + 1) % d;
+        uint32_t val = val1;
+        powerMod[i * PowerModTableSize] = val1;
+        for (int k = 1; k < PowerModTableSize; ++k) {
+            val = ((uint64_t)val * val1) % d;
+            powerMod[i * PowerModTableSize + k] = val;
+        }
+    }
+    return buildTableFile(PrecomputedTablesVersion, {
+        { PrimesTableId, sizeof(uint32_t), primes.data(), primes.size() },
+        { Primes64TableId, sizeof(uint64_t), primes64.data(), primes64.size() },
+        { PrimesDoubleTableId, sizeof(double), primesDouble.data(), primesDouble.size() },
+        { MultiplicativeInversesTableId, sizeof(uint64_t), inverses.data(), inverses.size() },
+        { MultiplicativeInversesDoubleTableId, sizeof(double), inversesDouble.data(), inversesDouble.size() },
+        { PowerModTableId, sizeof(uint32_t), powerMod.data(), powerMod.size() },
+    });
+}
+std::string precomputedTablesFileName() {
+    auto fileName = std::getenv("PRECOMPUTED_TABLES_FILE");
+    return fileName ? fileName : "Precomputed_Tables.dat";
+}
+void createPrecomputedTablesFile(const std::string& fileName) {
+    saveTableFile(fileName, createPrecomputedTablesContents());
+}
+PrecomputedTables loadPrecomputedTables() {
+    PrecomputedTables tables;
+    auto fileName = precomputedTablesFileName();
+    tables.file = TableFile(fileName, PrecomputedTablesVersion);
+    if (!tables.assignSections()) {
+        auto contents = createPrecomputedTablesContents();
+        saveTableFile(fileName, contents); // it is fine if it fails, tables are used from memory anyway
+        tables.file = TableFile(std::move(contents), PrecomputedTablesVersion);
+        tables.assignSections();
+    }
+    return tables;
+}
+const PrecomputedTables& precomputedTables() {
+    static const PrecomputedTables tables = loadPrecomputedTables();
+    return tables;
+}
+
+// array view of one of the precomputed tables, tables are loaded on first access
+template<typename T, const T* PrecomputedTables::*Table, std::size_t Size> struct PrecomputedTableView {
+    const T* data() const                         { return precomputedTables().*Table; }
+    std::size_t size() const                      { return Size; }
+    const T& operator[](std::size_t index) const  { return data()[index]; }
+    const T& back() const                         { return data()[Size - 1]; }
+    const T* begin() const                        { return data(); }
+    const T* end() const                          { return data() + Size; }
+};
+// view of table with Cols values per prime
+template<typename T, const T* PrecomputedTables::*Table, int Cols> struct PrecomputedTableView2d {
+    const T& operator()(int row, int col) const { return (precomputedTables().*Table)[col + row * Cols]; }
+};
+
+constexpr PrecomputedTableView<uint32_t, &PrecomputedTables::primes, PrecomputedTablesPrimeCount> Primes_1_000_000;
+constexpr PrecomputedTableView<uint64_t, &PrecomputedTables::primes64, PrecomputedTablesPrimeCount> Primes64_1_000_000;
+constexpr PrecomputedTableView<double, &PrecomputedTables::primesDouble, PrecomputedTablesPrimeCount> PrimesDouble64_1_000_000;
+constexpr PrecomputedTableView<uint64_t, &PrecomputedTables::multiplicativeInverses, PrecomputedTablesPrimeCount> MultiplicativeInverses;
+constexpr PrecomputedTableView<double, &PrecomputedTables::multiplicativeInversesDouble, PrecomputedTablesPrimeCount> MultiplicativeInversesDouble;
+constexpr PrecomputedTableView2d<uint32_t, &PrecomputedTables::powerMod, PowerModTableSize> PowerModTable;
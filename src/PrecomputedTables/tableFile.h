@@ -0,0 +1,230 @@
+#pragma once
+#include "../Utility/mappedFile.h"
+#ifndef _WIN32
+    #include <sys/file.h>
+#endif
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <span>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+
+/*
+    Binary file with arrays ("sections") which are used directly from the memory mapping, without copying.
+    Layout: TableFileHeader, header.sectionCount TableFileSection entries, then data of the sections,
+    each aligned to TableFileAlignment bytes. Files with different magic or version are ignored, so the
+    version has to be changed whenever contents or meaning of any section changes.
+*/
+constexpr char TableFileMagic[8] = { 'I', 'F', 'T', 'A', 'B', 'L', 'E', 'S' };
+constexpr uint64_t TableFileAlignment = 64;
+
+struct TableFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+};
+struct TableFileSection {
+    uint32_t id;
+    uint32_t elementSize;
+    uint64_t offset; // from the beginning of the file
+    uint64_t count;
+};
+
+// section to be written with buildTableFile
+struct TableFileSectionData {
+    uint32_t id;
+    uint32_t elementSize;
+    const void* data;
+    uint64_t count;
+};
+
+std::vector<uint8_t> buildTableFile(uint32_t version, const std::vector<TableFileSectionData>& sections) {
+    auto alignUp = [](uint64_t offset) { return (offset + TableFileAlignment - 1) / TableFileAlignment * TableFileAlignment; };
+    TableFileHeader header;
+    std::memcpy(header.magic, TableFileMagic, sizeof(header.magic));
+    header.version = version;
+    header.sectionCount = static_cast<uint32_t>(sections.size());
+
+    std::vector<TableFileSection> entries;
+    uint64_t offset = alignUp(sizeof(TableFileHeader) + sections.size() * sizeof(TableFileSection));
+    for (auto& section : sections) {
+        entries.push_back({ section.id, section.elementSize, offset, section.count });
+        offset = alignUp(offset + section.count * section.elementSize);
+    }
+
+    std::vector<uint8_t> contents(offset, 0);
+    std::memcpy(contents.data(), &header, sizeof(header));
+    std::memcpy(contents.data() + sizeof(header), entries.data(), entries.size() * sizeof(TableFileSection));
+    for (std::size_t i = 0; i < sections.size(); ++i) {
+        std::memcpy(contents.data() + entries[i].offset, sections[i].data, sections[i].count * sections[i].elementSize);
+    }
+    return contents;
+}
+
+// Writes to a temporary file with a name unique to this call first and renames it over fileName, so that other
+// processes never map a partially written file. The old file is left as it is if anything fails.
+bool saveTableFile(const std::string& fileName, const std::vector<uint8_t>& contents) {
+#ifdef _WIN32
+    static std::atomic<uint64_t> temporaryFileCounter = 0;
+    auto temporaryFileName = fileName + "." + std::to_string(GetCurrentProcessId()) + "." + std::to_string(temporaryFileCounter++) + ".tmp";
+    {
+        std::ofstream file(temporaryFileName, std::ios::binary);
+        if (!file.write(reinterpret_cast<const char*>(contents.data()), contents.size()) || !file.flush()) {
+            file.close();
+            DeleteFileA(temporaryFileName.c_str());
+            return false;
+        }
+    }
+    if (!MoveFileExA(temporaryFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileA(temporaryFileName.c_str());
+        return false;
+    }
+#else
+    std::string temporaryFileName = fileName + ".XXXXXX";
+    int fileDescriptor = mkstemp(temporaryFileName.data());
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    fchmod(fileDescriptor, 0644); // mkstemp creates the file readable only by its owner
+    FILE* file = fdopen(fileDescriptor, "wb");
+    if (!file) {
+        close(fileDescriptor);
+        std::remove(temporaryFileName.c_str());
+        return false;
+    }
+    bool isWritten = std::fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+    if (std::fclose(file) != 0 || !isWritten || std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0) {
+        std::remove(temporaryFileName.c_str());
+        return false;
+    }
+#endif
+    return true;
+}
+
+// Exclusive lock on fileName + ".lock", held while the object lives. Processes that rewrite a table file from
+// its current contents take it around the whole read-modify-write, so that they do not lose each other's changes.
+// isLocked() is false if the lock file could not be created, callers can then still rewrite the file unlocked.
+struct TableFileLock {
+    explicit TableFileLock(const std::string& fileName) {
+        auto lockFileName = fileName + ".lock";
+    #ifdef _WIN32
+        file = CreateFileA(lockFileName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        OVERLAPPED overlapped = {};
+        if (file != INVALID_HANDLE_VALUE && !LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped)) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+    #else
+        file = open(lockFileName.c_str(), O_RDWR | O_CREAT, 0644);
+        if (file >= 0 && flock(file, LOCK_EX) != 0) {
+            close(file);
+            file = -1;
+        }
+    #endif
+    }
+    ~TableFileLock() {
+        if (!isLocked()) {
+            return;
+        }
+    #ifdef _WIN32
+        CloseHandle(file); // also releases the lock
+    #else
+        close(file);
+    #endif
+    }
+    TableFileLock(const TableFileLock&) = delete;
+    TableFileLock& operator=(const TableFileLock&) = delete;
+
+    bool isLocked() const {
+    #ifdef _WIN32
+        return file != INVALID_HANDLE_VALUE;
+    #else
+        return file >= 0;
+    #endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+#else
+    int file = -1;
+#endif
+};
+
+// table file that is either memory mapped or held in memory, isValid() is false if it is missing or malformed
+struct TableFile {
+    TableFile() {}
+    TableFile(const std::string& fileName, uint32_t version) : mapping(fileName) {
+        if (!validate(mapping.data(), mapping.size(), version)) {
+            mapping = MappedFile{};
+        }
+    }
+    TableFile(std::vector<uint8_t> contents, uint32_t version) : memory(std::move(contents)) {
+        if (!validate(memory.data(), memory.size(), version)) {
+            memory.clear();
+        }
+    }
+
+    bool isValid() const {
+        return data() != nullptr;
+    }
+    const uint8_t* data() const {
+        return mapping.data() ? mapping.data() : (memory.empty() ? nullptr : memory.data());
+    }
+
+    // nullptr if there is no section with given id, element size and element count
+    template<typename T> const T* section(uint32_t id, uint64_t count) const {
+        auto elements = section<T>(id);
+        return elements.data() && elements.size() == count ? elements.data() : nullptr;
+    }
+    // whole section with given id, empty if there is no such section or it has other element size
+    template<typename T> std::span<const T> section(uint32_t id) const {
+        if (!isValid()) {
+            return {};
+        }
+        TableFileHeader header;
+        std::memcpy(&header, data(), sizeof(header));
+        for (uint32_t i = 0; i < header.sectionCount; ++i) {
+            TableFileSection entry;
+            std::memcpy(&entry, data() + sizeof(header) + i * sizeof(TableFileSection), sizeof(entry));
+            if (entry.id == id) {
+                if (entry.elementSize != sizeof(T)) {
+                    return {};
+                }
+                return { reinterpret_cast<const T*>(data() + entry.offset), static_cast<std::size_t>(entry.count) };
+            }
+        }
+        return {};
+    }
+
+private:
+    static bool validate(const uint8_t* contents, std::size_t size, uint32_t version) {
+        if (!contents || size < sizeof(TableFileHeader)) {
+            return false;
+        }
+        TableFileHeader header;
+        std::memcpy(&header, contents, sizeof(header));
+        if (std::memcmp(header.magic, TableFileMagic, sizeof(header.magic)) != 0 || header.version != version) {
+            return false;
+        }
+        if (sizeof(TableFileHeader) + static_cast<uint64_t>(header.sectionCount) * sizeof(TableFileSection) > size) {
+            return false;
+        }
+        for (uint32_t i = 0; i < header.sectionCount; ++i) {
+            TableFileSection entry;
+            std::memcpy(&entry, contents + sizeof(header) + i * sizeof(TableFileSection), sizeof(entry));
+            if (entry.offset % TableFileAlignment != 0 || entry.offset > size || entry.count > (size - entry.offset) / std::max<uint32_t>(entry.elementSize, 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    MappedFile mapping;
+    std::vector<uint8_t> memory;
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include "../BigInt/include.h"
+#include "bpsw.h"
+#include "isPrime64.h"
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Primality test of many numbers at once. Numbers of 2 to BatchPrimalityMaxSize limbs are grouped by their limb
+    count and the strong probable prime test to base 2 runs on BigIntLanesDefaultCount of them together in
+    BigIntFixedSizeLanes (each lane has its own modulus and exponent). Most composites fail it, so only the lanes
+    that pass go through the Lucas part of BPSW one by one.
+    1-limb numbers use isPrime64, which is faster than lanes of two 52-bit digits. Without vectorized lanes
+    or for bigger numbers it is the same as testing them one by one.
+*/
+constexpr int BatchPrimalityMaxSize = 4;
+constexpr std::size_t BatchPrimalityMinLaneCount = 4; // smaller groups are tested one by one
+
+template<int Size, int L> bool laneEquals(const BigIntFixedSizeLanes<Size, L>& a, const BigIntFixedSizeLanes<Size, L>& b, int lane) {
+    for (int d = 0; d < a.DigitCount; ++d) {
+        if (a.digit(d, lane) != b.digit(d, lane)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// strong probable prime test to base 2 of L odd numbers bigger than 2 (lanes that are not needed can repeat any of them)
+template<int Size, int L> std::array<bool, L> strongProbablePrimeBase2Lanes(const std::array<BigIntFixedSize<Size>, L>& n) {
+    using T = BigIntFixedSizeLanes<Size, L>;
+    auto m = getMontgomeryReductionMod<Size, L>(n);
+    // n - 1 = d * 2^s for every lane
+    std::array<BigIntFixedSize<Size>, L> d;
+    std::array<uint32_t, L> s;
+    int maxBits = 0;
+    uint32_t maxS = 0;
+    for (int l = 0; l < L; ++l) {
+        s[l] = oddPartOf(d[l], n[l], false);
+        maxBits = std::max(maxBits, static_cast<int>(d[l].sizeInBits()));
+        maxS = std::max(maxS, s[l]);
+    }
+    // 1 = 2^b / 2^b in Montgomery form of all lanes at once
+    T one;
+    for (int l = 0; l < L; ++l) {
+        one.digit(0, l) = 1;
+    }
+    for (uint32_t i = 0; i < m.b; ++i) {
+        modDbl(one, one, m);
+    }
+    T minusOne;
+    modNeg(minusOne, one, m);
+
+    // 2^d, shorter exponents just square 1 in the first iterations
+    T x = one;
+    T doubled;
+    for (int i = maxBits - 1; i >= 0; --i) {
+        modSqr(x, x, m);
+        modDbl(doubled, x, m);
+        for (int l = 0; l < L; ++l) {
+            if (d[l].bit(i)) {
+                for (int j = 0; j < x.DigitCount; ++j) {
+                    x.digit(j, l) = doubled.digit(j, l);
+                }
+            }
+        }
+    }
+    std::array<bool, L> result;
+    std::array<bool, L> isDone;
+    for (int l = 0; l < L; ++l) {
+        result[l] = laneEquals(x, one, l) || laneEquals(x, minusOne, l);
+        isDone[l] = result[l] || s[l] == 1;
+    }
+    for (uint32_t r = 1; r < maxS; ++r) {
+        if (std::all_of(isDone.begin(), isDone.end(), [](bool done) { return done; })) {
+            break;
+        }
+        modSqr(x, x, m);
+        for (int l = 0; l < L; ++l) {
+            if (isDone[l]) {
+                continue;
+            }
+            if (laneEquals(x, minusOne, l)) {
+                result[l] = true;
+                isDone[l] = true;
+            } else if (laneEquals(x, one, l) || r + 1 == s[l]) {
+                isDone[l] = true;
+            }
+        }
+    }
+    return result;
+}
+
+template<int Size> void batchIsProbablyPrime(std::vector<bool>& results, std::span<const BigInt> numbers, const std::vector<std::size_t>& indexes) {
+    constexpr int L = BigIntLanesDefaultCount;
+    for (std::size_t first = 0; first < indexes.size(); first += L) {
+        auto count = std::min<std::size_t>(L, indexes.size() - first);
+        if (count < BatchPrimalityMinLaneCount) {
+            for (std::size_t l = 0; l < count; ++l) {
+                results[indexes[first + l]] = bpswTest(numbers[indexes[first + l]].get<BigIntFixedSize<Size>>());
+            }
+            return;
+        }
+        std::array<BigIntFixedSize<Size>, L> n;
+        for (std::size_t l = 0; l < L; ++l) {
+            // unused lanes repeat the first number
+            n[l] = numbers[indexes[first + (l < count ? l : 0)]].get<BigIntFixedSize<Size>>();
+        }
+        auto isBase2Prime = strongProbablePrimeBase2Lanes<Size, L>(n);
+        for (std::size_t l = 0; l < count; ++l) {
+            results[indexes[first + l]] = isBase2Prime[l] && !isPerfectSquare(n[l]) && strongLucasProbablePrime(getMontgomeryReductionMod(n[l]));
+        }
+    }
+}
+
+std::vector<bool> batchIsProbablyPrime(std::span<const BigInt> numbers) {
+    std::vector<bool> results(numbers.size());
+    // indexes of odd numbers for every limb count
+    std::array<std::vector<std::size_t>, BatchPrimalityMaxSize + 1> groups;
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+        auto& n = numbers[i];
+        if (n.IsType<BigIntFixedSize<1>>()) {
+            results[i] = isPrime64(n.get<BigIntFixedSize<1>>()[0]);
+            continue;
+        }
+        // limb count of odd numbers that can go to lanes, 0 for the others
+        auto size = n.visitNoInit([](auto&& a) {
+            if constexpr (BigInt::IsType<decltype(a), BigIntGmp>()) {
+                return 0;
+            } else {
+                return a.mod[0] % 2 == 1 ? static_cast<int>(a.mod.data.size()) : 0;
+            }
+        });
+        if (!BigIntLanesAreVectorized || size == 0 || size > BatchPrimalityMaxSize) {
+            results[i] = bpswTest(n);
+        } else {
+            groups[size].push_back(i);
+        }
+    }
+    batchIsProbablyPrime<2>(results, numbers, groups[2]);
+    batchIsProbablyPrime<3>(results, numbers, groups[3]);
+    batchIsProbablyPrime<4>(results, numbers, groups[4]);
+    return results;
+}
@@ -0,0 +1,199 @@
+#pragma once
+#include "../BigInt/include.h"
+#include <cstdint>
+#include <gmp.h>
+
+/*
+    Baillie-PSW test: strong probable prime test to base 2 followed by strong Lucas probable prime test
+    with Selfridge's parameters (first D in 5, -7, 9, -11, ... with Jacobi symbol (D/n) = -1, P = 1, Q = (1 - D) / 4).
+    There are no pseudoprimes to it below 2^64, so it's deterministic for 1-limb numbers, and no pseudoprimes
+    are known above that.
+    All arithmetic is done on MontgomeryReductionMod<BigIntFixedSize<Size>>.
+*/
+
+// Jacobi symbol (a/m) for odd m
+int jacobiSymbol(uint64_t a, uint64_t m) {
+    int result = 1;
+    a %= m;
+    while (a != 0) {
+        auto zeros = trailingZeroBitCount(a);
+        a >>= zeros;
+        // (2/m) = -1 for m = 3, 5 (mod 8)
+        if ((zeros & 1) && (m % 8 == 3 || m % 8 == 5)) {
+            result = -result;
+        }
+        // quadratic reciprocity
+        if (a % 4 == 3 && m % 4 == 3) {
+            result = -result;
+        }
+        std::swap(a, m);
+        a %= m;
+    }
+    return m == 1 ? result : 0;
+}
+// (d/n) for small odd d (positive or negative) and odd n
+template<int Size> int jacobiSymbol(int64_t d, const BigIntFixedSize<Size>& n) {
+    uint64_t absD = d < 0 ? static_cast<uint64_t>(-d) : static_cast<uint64_t>(d);
+    // (|d|/n) = (n/|d|) * (-1)^((|d|-1)/2 * (n-1)/2), (-1/n) = (-1)^((n-1)/2)
+    int result = jacobiSymbol(n % absD, absD);
+    if (absD % 4 == 3 && n[0] % 4 == 3) {
+        result = -result;
+    }
+    if (d < 0 && n[0] % 4 == 3) {
+        result = -result;
+    }
+    return result;
+}
+
+template<int Size> bool isPerfectSquare(const BigIntFixedSize<Size>& n) {
+    return mpz_perfect_square_p(BigIntGmp{ n }.data) != 0;
+}
+
+// n - 1 = d * 2^s (or n + 1 if addOne), returns s
+template<int Size> uint32_t oddPartOf(BigIntFixedSize<Size>& d, const BigIntFixedSize<Size>& n, bool addOne) {
+    d = n;
+    if (addOne) {
+        d += 1;
+    } else {
+        d -= 1;
+    }
+    uint32_t s = 0;
+    while (d[0] == 0) {
+        shr(d, d, 64);
+        s += 64;
+    }
+    auto zeros = static_cast<uint32_t>(trailingZeroBitCount(d[0]));
+    shr(d, d, zeros);
+    return s + zeros;
+}
+
+// n is odd and bigger than 2
+template<int Size> bool strongProbablePrimeBase2(const MontgomeryReductionMod<BigIntFixedSize<Size>>& m) {
+    using T = BigIntFixedSize<Size>;
+    T d;
+    auto s = oddPartOf(d, m.mod, false);
+    T one = getConstant(1, m);
+    T minusOne;
+    modNeg(minusOne, one, m);
+    // 2^d with left-to-right binary exponentiation, multiplication by 2 is a modular doubling
+    T x = one;
+    for (int i = static_cast<int>(d.sizeInBits()) - 1; i >= 0; --i) {
+        modSqr(x, x, m);
+        if (d.bit(i)) {
+            modDbl(x, x, m);
+        }
+    }
+    if (x == one || x == minusOne) {
+        return true;
+    }
+    for (uint32_t r = 1; r < s; ++r) {
+        modSqr(x, x, m);
+        if (x == minusOne) return true;
+        if (x == one) return false;
+    }
+    return false;
+}
+
+// x / 2 mod n (for odd x it's (x + n) / 2, computed without overflow)
+template<int Size> void modHalf(BigIntFixedSize<Size>& x, const BigIntFixedSize<Size>& n) {
+    bool isOdd = x[0] & 1;
+    shr(x, x, 1);
+    if (isOdd) {
+        BigIntFixedSize<Size> halfN;
+        shr(halfN, n, 1);
+        add(x, x, halfN);
+        x += 1;
+    }
+}
+
+// n is odd, bigger than 2 and not a perfect square
+template<int Size> bool strongLucasProbablePrime(const MontgomeryReductionMod<BigIntFixedSize<Size>>& m) {
+    using T = BigIntFixedSize<Size>;
+    const auto& n = m.mod;
+    int64_t D = 5;
+    while (true) {
+        auto jacobi = jacobiSymbol(D, n);
+        if (jacobi == -1) break;
+        // n has a factor |D|, unless it is |D|
+        if (jacobi == 0 && !(n.realSize() == 1 && n[0] == static_cast<uint64_t>(D < 0 ? -D : D))) return false;
+        D = D < 0 ? -D + 2 : -(D + 2);
+    }
+    auto toMontgomery = [&](int64_t value) {
+        T r = getConstant(static_cast<uint64_t>(value < 0 ? -value : value), m);
+        if (value < 0) {
+            modNeg(r, r, m);
+        }
+        return r;
+    };
+    T montD = toMontgomery(D);
+    T Q = toMontgomery((1 - D) / 4);
+    T d;
+    auto s = oddPartOf(d, n, true);
+
+    // U_k, V_k, Q^k from k = 1, doubling: U_2k = U_k V_k, V_2k = V_k^2 - 2 Q^k,
+    // increment (P = 1): U_k+1 = (U_k + V_k) / 2, V_k+1 = (D U_k + V_k) / 2
+    T U = getConstant(1, m);
+    T V = U;
+    T Qk = Q;
+    T tmp;
+    for (int i = static_cast<int>(d.sizeInBits()) - 2; i >= 0; --i) {
+        modMul(U, U, V, m);
+        modSqr(V, V, m);
+        modDbl(tmp, Qk, m);
+        modSub(V, V, tmp, m);
+        modSqr(Qk, Qk, m);
+        if (d.bit(i)) {
+            modMul(tmp, montD, U, m);
+            modAdd(U, U, V, m);
+            modHalf(U, n);
+            modAdd(V, V, tmp, m);
+            modHalf(V, n);
+            modMul(Qk, Qk, Q, m);
+        }
+    }
+    if (isZero(U) || isZero(V)) {
+        return true;
+    }
+    for (uint32_t r = 1; r < s; ++r) {
+        modSqr(V, V, m);
+        modDbl(tmp, Qk, m);
+        modSub(V, V, tmp, m);
+        if (isZero(V)) return true;
+        modSqr(Qk, Qk, m);
+    }
+    return false;
+}
+
+template<int Size> bool bpswTest(const MontgomeryReductionMod<BigIntFixedSize<Size>>& m) {
+    const auto& n = m.mod;
+    if (n.realSize() == 1 && n[0] < 4) {
+        return n[0] >= 2;
+    }
+    if (n[0] % 2 == 0) {
+        return false;
+    }
+    return strongProbablePrimeBase2(m) && !isPerfectSquare(n) && strongLucasProbablePrime(m);
+}
+template<int Size> bool bpswTest(const BigIntFixedSize<Size>& n) {
+    if (n[0] % 2 == 0) {
+        return n.realSize() == 1 && n[0] == 2;
+    }
+    return bpswTest(getMontgomeryReductionMod(n));
+}
+bool bpswTest(uint64_t n) {
+    // like in BigInt, 1-limb Montgomery arithmetic needs a spare bit
+    if (n >> 63) {
+        return bpswTest(BigIntFixedSize<2>{ n });
+    }
+    return bpswTest(BigIntFixedSize<1>{ n });
+}
+// BigIntGmp numbers use GMP's own test, which also starts with BPSW
+bool bpswTest(const BigInt& n) {
+    return n.visitNoInit([](auto&& a) {
+        if constexpr (BigInt::IsType<decltype(a), BigIntGmp>()) {
+            return mpz_probab_prime_p(a.mod.data, 1) != 0;
+        } else {
+            return bpswTest(a.mod);
+        }
+    });
+}
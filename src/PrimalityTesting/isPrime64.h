@@ -0,0 +1,156 @@
+#pragma once
+#include "bpsw.h"
+#include "../BigInt/Montgomery64.h"
+#include "../Factorization/SmallFactorization.h"
+#include "../Utility/bitManipulation.h"
+#include <array>
+#include <cstdint>
+
+/*
+    Deterministic primality test of uint64_t numbers on Montgomery64 (no BigIntFixedSize, no random bases):
+    - divisibility by primes below 64 (one multiplication by the inverse of the prime and one comparison each),
+    - below 2^32 strong probable prime tests to base 2 and to a second base taken from Prime32SecondBases
+      by a hash of n. The table is built so that every strong pseudoprime to base 2 below 2^32 fails the test
+      with the base of its bucket, so two tests are enough instead of the three of {2, 7, 61},
+    - above 2^32 base 2 strong test and strong Lucas test (BPSW), which has no pseudoprimes below 2^64.
+*/
+constexpr uint64_t Prime64SmallPrimeBound = 64;
+
+struct SmallPrimeDivisibility {
+    uint64_t prime;
+    uint64_t inverse;  // prime^-1 mod 2^64
+    uint64_t maxQuotient; // (2^64 - 1) / prime, n * inverse <= maxQuotient iff prime divides n
+};
+constexpr auto SmallPrimeDivisibilityTable = []() {
+    std::array<SmallPrimeDivisibility, 17> table{};
+    std::size_t count = 0;
+    for (uint64_t p = 3; p < Prime64SmallPrimeBound; p += 2) {
+        bool isPrime = true;
+        for (uint64_t q = 3; q * q <= p; q += 2) {
+            isPrime = isPrime && p % q != 0;
+        }
+        if (isPrime) {
+            uint64_t inverse = p;
+            for (int i = 0; i < 5; ++i) {
+                inverse *= 2 - p * inverse;
+            }
+            table[count++] = { p, inverse, ~0ull / p };
+        }
+    }
+    return table;
+}();
+
+// smallest prime below Prime64SmallPrimeBound dividing n, or 1
+uint64_t smallPrimeFactor64(uint64_t n) {
+    if (n % 2 == 0) {
+        return n == 0 ? 1 : 2;
+    }
+    for (auto& entry : SmallPrimeDivisibilityTable) {
+        if (n * entry.inverse <= entry.maxQuotient) {
+            return entry.prime;
+        }
+    }
+    return 1;
+}
+
+// for every bucket a base for which no strong pseudoprime to base 2 below 2^32 in that bucket is a strong probable prime
+// (smallest such base, found by testing all 2314 of them)
+constexpr std::array<uint16_t, 16> Prime32SecondBases = {
+    2249, 483, 194, 199, 15, 369, 499, 945, 419, 735, 33, 471, 946, 615, 497, 702
+};
+uint32_t prime32SecondBaseHash(uint32_t n) {
+    uint32_t h = ((n >> 16) ^ n) * 0x45d9f3b;
+    return ((h >> 16) ^ h) % Prime32SecondBases.size();
+}
+
+// n - 1 = d * 2^s
+bool strongProbablePrime64(const Montgomery64& m, uint64_t base, uint64_t d, int s) {
+    base %= m.n;
+    if (base == 0) {
+        return true;
+    }
+    uint64_t minusOne = m.n - m.one;
+    uint64_t x = m.pow(m.toMontgomery(base), d);
+    if (x == m.one || x == minusOne) {
+        return true;
+    }
+    for (int r = 1; r < s; ++r) {
+        x = m.sqr(x);
+        if (x == minusOne) return true;
+        if (x == m.one) return false;
+    }
+    return false;
+}
+
+// same as strongLucasProbablePrime for BigIntFixedSize, n is odd, not a perfect square and without small factors
+bool strongLucasProbablePrime64(const Montgomery64& m) {
+    auto n = m.n;
+    int64_t D = 5;
+    while (true) {
+        auto absD = static_cast<uint64_t>(D < 0 ? -D : D);
+        auto jacobi = jacobiSymbol(D < 0 ? n - absD % n : absD, n);
+        if (jacobi == -1) break;
+        if (jacobi == 0 && absD != n) return false;
+        D = D < 0 ? -D + 2 : -(D + 2);
+    }
+    auto toMontgomery = [&](int64_t value) {
+        auto r = m.toMontgomery(static_cast<uint64_t>(value < 0 ? -value : value));
+        return value < 0 ? m.sub(0, r) : r;
+    };
+    // x / 2 mod n, (x + n) / 2 for odd x
+    auto half = [n](uint64_t x) {
+        return (x >> 1) + ((x & 1) ? (n >> 1) + 1 : 0);
+    };
+    uint64_t montD = toMontgomery(D);
+    uint64_t Q = toMontgomery((1 - D) / 4);
+    int s = trailingZeroBitCount(n + 1);
+    uint64_t d = (n + 1) >> s;
+
+    uint64_t U = m.one;
+    uint64_t V = m.one;
+    uint64_t Qk = Q;
+    for (int i = static_cast<int>(sizeInBits(d)) - 2; i >= 0; --i) {
+        U = m.mul(U, V);
+        V = m.sub(m.sqr(V), m.add(Qk, Qk));
+        Qk = m.sqr(Qk);
+        if ((d >> i) & 1) {
+            auto DU = m.mul(montD, U);
+            U = half(m.add(U, V));
+            V = half(m.add(V, DU));
+            Qk = m.mul(Qk, Q);
+        }
+    }
+    if (U == 0 || V == 0) {
+        return true;
+    }
+    for (int r = 1; r < s; ++r) {
+        V = m.sub(m.sqr(V), m.add(Qk, Qk));
+        if (V == 0) return true;
+        Qk = m.sqr(Qk);
+    }
+    return false;
+}
+
+bool isPrime64(uint64_t n) {
+    if (n < Prime64SmallPrimeBound) {
+        return n >= 2 && smallPrimeFactor64(n) == n;
+    }
+    if (smallPrimeFactor64(n) != 1) {
+        return false;
+    }
+    // composites without factors below 64 are at least 67^2
+    if (n < 67 * 67) {
+        return true;
+    }
+    Montgomery64 m(n);
+    int s = trailingZeroBitCount(n - 1);
+    uint64_t d = (n - 1) >> s;
+    if (!strongProbablePrime64(m, 2, d, s)) {
+        return false;
+    }
+    if (n >> 32 == 0) {
+        return strongProbablePrime64(m, Prime32SecondBases[prime32SecondBaseHash(static_cast<uint32_t>(n))], d, s);
+    }
+    uint64_t root;
+    return !isSquare(n, root) && strongLucasProbablePrime64(m);
+}
@@ -1,26 +1,26 @@
 #pragma once
 #include "../BigInt/include.h"
-#include "../PrimalityTesting/millerRabin.h"
+#include "../PrimalityTesting/bpsw.h"
+#include "../PrimalityTesting/isPrime64.h"
 #include "../Factorization/TrialDivision.h"
 
-constexpr uint64_t PrimeTesting1LimbTrialDivisionThreshold = 1ull << 48;
 constexpr uint64_t PrimeTestingMultiLimbTrialDivisionThreshold = 1ull << 14;
 
 bool isProbablyPrime(const BigInt& n, BigInt& factor, bool writeDebug=false) {
 	factor = 1;
 	if (n.IsType<BigIntFixedSize<1>>()) {
 		auto nVal = n.get<BigIntFixedSize<1>>()[0];
-		if (nVal < PrimeTesting1LimbTrialDivisionThreshold) {
-			if (writeDebug) writeln("Running Trial Division with bound=", PrimeTesting1LimbTrialDivisionThreshold, "...");
-			auto trialResult = trialDivision(nVal);
-			if (trialResult != nVal) {
-				factor = trialResult;
-			}
-			return trialResult == nVal;
-		} else {
-			if (writeDebug) writeln("Running Miller-Rabin primality test...");
-			return millerRabinTest(nVal);
+		if (nVal == 1) {
+			return true; // nothing left to factor
 		}
+		if (writeDebug) writeln("Running Trial Division with bound=", Prime64SmallPrimeBound, "...");
+		auto smallFactor = smallPrimeFactor64(nVal);
+		if (smallFactor != 1 && smallFactor != nVal) {
+			factor = smallFactor;
+			return false;
+		}
+		if (writeDebug) writeln("Running deterministic 64-bit primality test...");
+		return isPrime64(nVal);
 	} else {
 		if (writeDebug) writeln("Running Trial Division with bound=", PrimeTestingMultiLimbTrialDivisionThreshold, "...");
 		auto trialResult = trialDivision(n, PrimeTestingMultiLimbTrialDivisionThreshold);
@@ -28,8 +28,8 @@ bool isProbablyPrime(const BigInt& n, BigInt& factor, bool writeDebug=false) {
 			factor = trialResult;
 			return false;
 		}
-		if (writeDebug) writeln("Running Miller-Rabin primality test...");
-		return millerRabinTest(n);
+		if (writeDebug) writeln("Running BPSW primality test...");
+		return bpswTest(n);
 	}
 }
 bool isProbablyPrime(const BigInt& n) {
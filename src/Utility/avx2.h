@@ -5,16 +5,23 @@
 #include <cstdint>
 #include <limits>
 #include "compilerMacros.h"
+#include "cpuFeatures.h"
 #include <iostream>
 
+/*
+    AVX2 code is always compiled (inside TARGET_AVX2_BEGIN/TARGET_END), but it can only be executed
+    if CurrentCpuFeatures.avx2 is set.
+*/
+TARGET_AVX2_BEGIN
+
 namespace avx {
     template<typename T> constexpr bool IsCompatible = 
         ((sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8) && std::is_integral_v<T>) 
         || std::numeric_limits<T>::is_iec559;
 
-#ifdef __AVX2__
+#if defined(__AVX2__) || defined(COMPILER_GCC) || defined(COMPILER_CLANG) || defined(COMPILER_MSVC)
     #define AVX2_IS_AVAILABLE
-    constexpr bool IsAvailable = true;        
+    constexpr bool IsAvailable = true;
 #else
     constexpr bool IsAvailable = false;
 #endif
@@ -222,6 +229,11 @@ namespace avx {
         else if constexpr (std::is_same_v<T, float>) return _mm256_movemask_epi8(_mm256_castps_si256(a));
         else return _mm256_movemask_epi8(a);
     }
+    // one bit per element (highest bit of the element), for 64-bit types
+    template<typename T> uint32_t laneMask(const AvxType<T>& a) {
+        if constexpr (std::is_same_v<T, double>) return _mm256_movemask_pd(a);
+        else return _mm256_movemask_pd(_mm256_castsi256_pd(a));
+    }
 #else
     template<typename T> AvxType<T> loadAligned(const T* ptr) { return AvxType<T>{}; }
     template<typename T> AvxType<T> loadUnaligned(const T* ptr) { return AvxType<T>{}; }
@@ -269,3 +281,5 @@ template<typename T> AvxType<T> operator<=(const AvxType<T>& a, const AvxType<T>
 template<typename T> AvxType<T> operator>=(const AvxType<T>& a, const AvxType<T>& b) {
     return avx::greaterOrEqual(a, b);
 }
+
+TARGET_END
@@ -0,0 +1,120 @@
+#pragma once
+#include <immintrin.h>
+#include <type_traits>
+#include <cstdint>
+#include <limits>
+#include "compilerMacros.h"
+#include "cpuFeatures.h"
+
+/*
+    Counterpart of avx2.h for 512-bit vectors, only 64-bit elements (uint64_t and double) are supported.
+    Comparisons return masks with one bit per element instead of vectors.
+    Zero-masked variants of intrinsics are used where GCC warns about _mm512_undefined_* values in the plain ones.
+    Compiled inside TARGET_AVX512_BEGIN/TARGET_END, so it can only be executed if CurrentCpuFeatures.avx512f
+    and CurrentCpuFeatures.avx512dq are set.
+*/
+TARGET_AVX512_BEGIN
+
+template<typename ValueType, typename Enable = void> struct Avx512Type;
+
+// 64 bit integer type
+template<typename ValueType> struct Avx512Type<ValueType, typename std::enable_if_t<sizeof(ValueType) == 8 && std::is_integral_v<ValueType>>> {
+    __m512i value;
+    Avx512Type(const __m512i& value) : value(value) {}
+    operator __m512i() const { return value; }
+};
+
+// IEEE 754 binary64 type
+template<> struct Avx512Type<double, typename std::enable_if_t<sizeof(double) == 8 && std::numeric_limits<double>::is_iec559>> {
+    __m512d value;
+    Avx512Type(const __m512d& value) : value(value) {}
+    operator __m512d() const { return value; }
+};
+
+namespace avx512 {
+    template<typename T> constexpr int packedCount() {
+        return 512 / 8 / sizeof(T);
+    }
+
+    // load/store from/to memory
+    template<typename T> Avx512Type<T> load(const T* ptr) { return _mm512_loadu_si512(ptr); }
+    Avx512Type<double> load(const double* ptr)            { return _mm512_loadu_pd(ptr); }
+
+    template<typename T> void store(T* dst, const Avx512Type<T>& src) { _mm512_storeu_si512(dst, src); }
+    void store(double* dst, const Avx512Type<double>& src)            { _mm512_storeu_pd(dst, src); }
+
+    // arithmetic
+    template<typename T> Avx512Type<T> add(const Avx512Type<T>& a, const Avx512Type<T>& b) { return _mm512_add_epi64(a, b); }
+    Avx512Type<double> add(const Avx512Type<double>& a, const Avx512Type<double>& b)       { return _mm512_add_pd(a, b); }
+
+    template<typename T> Avx512Type<T> sub(const Avx512Type<T>& a, const Avx512Type<T>& b) { return _mm512_sub_epi64(a, b); }
+    Avx512Type<double> sub(const Avx512Type<double>& a, const Avx512Type<double>& b)       { return _mm512_sub_pd(a, b); }
+
+    template<typename T> Avx512Type<T> mul(const Avx512Type<T>& a, const Avx512Type<T>& b) { return _mm512_mullo_epi64(a, b); }
+    Avx512Type<double> mul(const Avx512Type<double>& a, const Avx512Type<double>& b)       { return _mm512_mul_pd(a, b); }
+
+    Avx512Type<double> div(const Avx512Type<double>& a, const Avx512Type<double>& b) { return _mm512_div_pd(a, b); }
+
+    // conversion of 64-bit integers to doubles (exact for values below 2^53)
+    template<typename T> Avx512Type<double> toDouble(const Avx512Type<T>& a) { return _mm512_cvtepu64_pd(a); }
+
+    // initialization
+    template<typename T> Avx512Type<T> zero() { return _mm512_setzero_si512(); }
+    template<> Avx512Type<double> zero()      { return _mm512_setzero_pd(); }
+
+    template<typename T> Avx512Type<T> setElements(T value) { return _mm512_set1_epi64(value); }
+    template<> Avx512Type<double> setElements(double value) { return _mm512_set1_pd(value); }
+
+    template<typename T> Avx512Type<T> setElements(T v1, T v2, T v3, T v4, T v5, T v6, T v7, T v8) {
+        return _mm512_setr_epi64(v1, v2, v3, v4, v5, v6, v7, v8);
+    }
+    template<> Avx512Type<double> setElements(double v1, double v2, double v3, double v4, double v5, double v6, double v7, double v8) {
+        return _mm512_setr_pd(v1, v2, v3, v4, v5, v6, v7, v8);
+    }
+
+    // get single elements
+    template<int Index, typename T> T getElement(const Avx512Type<T>& a) {
+        if constexpr (Index == 0) return static_cast<T>(_mm_cvtsi128_si64(_mm512_maskz_extracti32x4_epi32(0xF, a, 0)));
+        alignas(64) T elements[8];
+        store(elements, a);
+        return elements[Index];
+    }
+    template<int Index> double getElement(const Avx512Type<double>& a) {
+        if constexpr (Index == 0) return _mm512_cvtsd_f64(a);
+        alignas(64) double elements[8];
+        store(elements, a);
+        return elements[Index];
+    }
+    template<typename T> T getElement(const Avx512Type<T>& a, int index) {
+        alignas(64) T elements[8];
+        store(elements, a);
+        return elements[index];
+    }
+
+    // other
+    Avx512Type<double> floor(const Avx512Type<double>& a) {
+        return _mm512_maskz_roundscale_pd(0xFF, a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    }
+    // one bit per element
+    uint32_t equal(const Avx512Type<double>& a, const Avx512Type<double>& b) {
+        return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ);
+    }
+    template<typename T> uint32_t equal(const Avx512Type<T>& a, const Avx512Type<T>& b) {
+        return _mm512_cmpeq_epi64_mask(a, b);
+    }
+}
+
+template<typename T> Avx512Type<T> operator+(const Avx512Type<T>& a, const Avx512Type<T>& b) {
+    return avx512::add(a, b);
+}
+template<typename T> Avx512Type<T> operator-(const Avx512Type<T>& a, const Avx512Type<T>& b) {
+    return avx512::sub(a, b);
+}
+template<typename T> Avx512Type<T> operator*(const Avx512Type<T>& a, const Avx512Type<T>& b) {
+    return avx512::mul(a, b);
+}
+template<typename T> Avx512Type<T> operator/(const Avx512Type<T>& a, const Avx512Type<T>& b) {
+    return avx512::div(a, b);
+}
+
+TARGET_END
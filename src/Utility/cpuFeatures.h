@@ -0,0 +1,88 @@
+#pragma once
+#include "compilerMacros.h"
+#include <cstdint>
+
+#ifdef COMPILER_MSVC
+    #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+#endif
+
+/*
+    Instruction set extensions of the CPU the program runs on, detected with CPUID.
+    Used to select kernels at runtime, so that one binary works on CPUs without them.
+*/
+struct CpuFeatures {
+    bool bmi2 = false;       // MULX
+    bool adx = false;        // ADCX, ADOX
+    bool avx2 = false;
+    bool avx512f = false;
+    bool avx512dq = false;
+    bool avx512ifma = false;
+};
+
+CpuFeatures detectCpuFeatures() {
+    CpuFeatures features;
+#if defined(COMPILER_MSVC) || defined(__x86_64__) || defined(__i386__)
+    auto cpuid = [](uint32_t leaf, uint32_t subleaf, uint32_t (&regs)[4]) {
+    #ifdef COMPILER_MSVC
+        int info[4];
+        __cpuidex(info, leaf, subleaf);
+        for (int i = 0; i < 4; ++i) {
+            regs[i] = static_cast<uint32_t>(info[i]);
+        }
+    #else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+    };
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    if (regs[0] < 7) {
+        return features;
+    }
+    cpuid(1, 0, regs);
+    bool osSavesAvxState = false;
+    bool osSavesAvx512State = false;
+    if (regs[2] & (1u << 27)) { // OSXSAVE
+    #ifdef COMPILER_MSVC
+        uint64_t xcr0 = _xgetbv(0);
+    #else
+        uint32_t xcr0Low, xcr0High;
+        __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+        uint64_t xcr0 = (static_cast<uint64_t>(xcr0High) << 32) | xcr0Low;
+    #endif
+        osSavesAvxState = (xcr0 & 0x6) == 0x6;
+        osSavesAvx512State = osSavesAvxState && (xcr0 & 0xE0) == 0xE0;
+    }
+    cpuid(7, 0, regs);
+    features.bmi2 = regs[1] & (1u << 8);
+    features.adx = regs[1] & (1u << 19);
+    features.avx2 = osSavesAvxState && (regs[1] & (1u << 5));
+    features.avx512f = osSavesAvx512State && (regs[1] & (1u << 16));
+    features.avx512dq = features.avx512f && (regs[1] & (1u << 17));
+    features.avx512ifma = features.avx512f && (regs[1] & (1u << 21));
+#endif
+    return features;
+}
+
+const CpuFeatures CurrentCpuFeatures = detectCpuFeatures();
+
+/*
+    Functions defined between TARGET_*_BEGIN and TARGET_END are compiled with the given instruction set
+    enabled, even if the rest of the program is not. They can only be called after checking CurrentCpuFeatures.
+    Headers have to be included before TARGET_*_BEGIN, otherwise their functions would be compiled for the target too.
+*/
+#if defined(COMPILER_GCC)
+    #define TARGET_AVX2_BEGIN   _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+    #define TARGET_AVX512_BEGIN _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,avx512f,avx512dq\")")
+    #define TARGET_END          _Pragma("GCC pop_options")
+#elif defined(COMPILER_CLANG)
+    #define TARGET_AVX2_BEGIN   _Pragma("clang attribute push(__attribute__((target(\"avx2\"))), apply_to = function)")
+    #define TARGET_AVX512_BEGIN _Pragma("clang attribute push(__attribute__((target(\"avx2,avx512f,avx512dq\"))), apply_to = function)")
+    #define TARGET_END          _Pragma("clang attribute pop")
+#else
+    // MSVC allows intrinsics of any instruction set in every function
+    #define TARGET_AVX2_BEGIN
+    #define TARGET_AVX512_BEGIN
+    #define TARGET_END
+#endif
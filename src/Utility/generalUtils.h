@@ -10,6 +10,8 @@
 #include <algorithm>
 #include <random>
 #include <ctime>
+#include <thread>
+#include <functional>
 
 template<typename T> std::ostream& operator<<(std::ostream& out, const std::vector<T>& vec) {
     if (vec.empty())
@@ -190,7 +192,7 @@ template<typename T, typename U> auto geometricRange(T start, T end, U multiplyF
 //------------
 // Random
 //------------
-static inline std::mt19937_64 _randomGen(std::time(nullptr));
+static inline thread_local std::mt19937_64 _randomGen(std::time(nullptr) ^ std::hash<std::thread::id>{}(std::this_thread::get_id()));
 template<typename T = double> T random(T start=0, T end=1) {
     if constexpr (std::is_integral_v<T>) {
         if constexpr (sizeof(T) == 1) {
@@ -0,0 +1,92 @@
+#pragma once
+#include "compilerMacros.h"
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. Pages are read on first access and shared between
+// processes through the page cache. data() is nullptr if the file could not be mapped.
+struct MappedFile {
+    MappedFile() {}
+    MappedFile(const std::string& fileName) {
+    #ifdef _WIN32
+        auto file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                ptr = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                length = ptr ? static_cast<std::size_t>(fileSize.QuadPart) : 0;
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    #else
+        int file = open(fileName.c_str(), O_RDONLY);
+        if (file < 0) {
+            return;
+        }
+        struct stat fileStat;
+        if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0) {
+            void* mapping = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, file, 0);
+            if (mapping != MAP_FAILED) {
+                ptr = static_cast<const uint8_t*>(mapping);
+                length = static_cast<std::size_t>(fileStat.st_size);
+            }
+        }
+        close(file);
+    #endif
+    }
+    ~MappedFile() {
+        unmap();
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            ptr = std::exchange(other.ptr, nullptr);
+            length = std::exchange(other.length, 0);
+        }
+        return *this;
+    }
+
+    const uint8_t* data() const { return ptr; }
+    std::size_t size() const    { return length; }
+
+private:
+    void unmap() {
+        if (!ptr) {
+            return;
+        }
+    #ifdef _WIN32
+        UnmapViewOfFile(ptr);
+    #else
+        munmap(const_cast<uint8_t*>(ptr), length);
+    #endif
+        ptr = nullptr;
+        length = 0;
+    }
+
+    const uint8_t* ptr = nullptr;
+    std::size_t length = 0;
+};
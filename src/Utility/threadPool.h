@@ -0,0 +1,161 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+// Counts tasks that were submitted to a ThreadPool but did not finish yet (and those that did not start yet).
+struct TaskGroup {
+    std::atomic<int> pendingCount = 0;
+    std::atomic<int> queuedCount = 0;
+};
+
+// Work-stealing pool. Every worker owns a deque; tasks submitted from a worker go to its own deque
+// and are executed LIFO, idle workers steal the oldest tasks from others. Tasks submitted from outside
+// of the pool go to a shared injection queue.
+struct ThreadPool {
+    ThreadPool(int workerCount) {
+        for (int i = 0; i <= workerCount; ++i) {
+            queues.emplace_back(std::make_unique<TaskQueue>());
+        }
+        for (int i = 0; i < workerCount; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        stateChanged.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // number of threads that can execute tasks simultaneously (workers + thread calling wait)
+    int concurrency() const {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    void run(TaskGroup& group, std::function<void()> task) {
+        group.pendingCount += 1;
+        auto& queue = *queues[currentQueueIndex()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back({ &group, std::move(task) });
+            group.queuedCount += 1;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            queuedCount += 1;
+        }
+        stateChanged.notify_all();
+    }
+
+    // Waits until all tasks of the group are finished.
+    // Calling thread executes (or steals) queued tasks of this group in the meantime, so it is safe to wait from
+    // inside a task. Tasks of other groups are left to the workers, so the time a task spends in wait() is only
+    // spent on its own subtasks and nested waits cannot pile up on one thread's stack.
+    void wait(TaskGroup& group) {
+        auto queueIndex = currentQueueIndex();
+        while (group.pendingCount > 0) {
+            if (!tryRunOneTask(queueIndex, &group)) {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                stateChanged.wait(lock, [&] { return group.pendingCount == 0 || group.queuedCount > 0; });
+            }
+        }
+    }
+
+private:
+    struct Task {
+        TaskGroup* group;
+        std::function<void()> function;
+    };
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    inline static thread_local const ThreadPool* currentPool = nullptr;
+    inline static thread_local int currentWorkerIndex = 0;
+
+    int currentQueueIndex() const {
+        return currentPool == this ? currentWorkerIndex : static_cast<int>(workers.size());
+    }
+
+    // group == nullptr takes a task of any group
+    bool tryPop(int queueIndex, Task& task, bool fromBack, const TaskGroup* group) {
+        auto& queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        auto isWanted = [group](const Task& queued) { return !group || queued.group == group; };
+        auto it = queue.tasks.end();
+        if (fromBack) {
+            auto reverseIt = std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), isWanted);
+            it = reverseIt == queue.tasks.rend() ? queue.tasks.end() : std::prev(reverseIt.base());
+        } else {
+            it = std::find_if(queue.tasks.begin(), queue.tasks.end(), isWanted);
+        }
+        if (it == queue.tasks.end()) {
+            return false;
+        }
+        task = std::move(*it);
+        queue.tasks.erase(it);
+        task.group->queuedCount -= 1;
+        queuedCount -= 1;
+        return true;
+    }
+    bool tryRunOneTask(int queueIndex, const TaskGroup* group = nullptr) {
+        Task task;
+        int queueCount = static_cast<int>(queues.size());
+        bool found = tryPop(queueIndex, task, true, group);
+        for (int i = 1; !found && i < queueCount; ++i) {
+            found = tryPop((queueIndex + i) % queueCount, task, false, group);
+        }
+        if (!found) {
+            return false;
+        }
+        task.function();
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            task.group->pendingCount -= 1;
+        }
+        stateChanged.notify_all();
+        return true;
+    }
+    void workerLoop(int workerIndex) {
+        currentPool = this;
+        currentWorkerIndex = workerIndex;
+        while (true) {
+            if (tryRunOneTask(workerIndex)) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(stateMutex);
+            stateChanged.wait(lock, [this] { return stopping || queuedCount > 0; });
+            if (stopping && queuedCount == 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<TaskQueue>> queues; // one per worker + injection queue at the end
+    std::atomic<int> queuedCount = 0;
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+    bool stopping = false;
+};
+
+// Pool shared by all parallel algorithms. Created on first use.
+ThreadPool& globalThreadPool() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
@@ -0,0 +1,37 @@
+// Standalone regression tests for ECM, returns nonzero on failure.
+// Build from the repository root, e.g.: g++ -std=c++20 -O2 -Isrc tests/ecmTest.cpp -lgmp
+
+#include "Factorization/factor.h"
+
+#include <iostream>
+#include <string>
+
+namespace {
+
+// every curve form must find the 40-bit factor of this 110-bit semiprime with B1 = 2000
+bool testFindsFactor(EllipticCurveForm form, EcmMulMethod mulMethod, const char* formName) {
+    const BigInt n{ std::string("1298074214651415781470873042551159") };
+    bool ok = true;
+    for (bool vectorizeCurves : { false, true }) {
+        EcmContext context(mulMethod, EcmMulCascadeMethod::Seperate, 2000, 100000, 300);
+        context.vectorizeCurves = vectorizeCurves;
+        // compared as strings, BigInt equality also compares the limb count
+        std::string factor = ecm(context, form, n).toString();
+        if (factor != "1099511627791" && factor != "1180591620717411303449") {
+            std::cout << "FAIL: " << formName << " ECM (vectorizeCurves = " << vectorizeCurves << ") returned " << factor << " after " << context.out_curveDoneCount << " curves\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+}
+
+int main() {
+    bool ok = true;
+    ok &= testFindsFactor(EllipticCurveForm::ShortWeierstrass, EcmMulMethod::Naf, "ShortWeierstrass");
+    ok &= testFindsFactor(EllipticCurveForm::TwistedEdwards, EcmMulMethod::Naf, "TwistedEdwards");
+    ok &= testFindsFactor(EllipticCurveForm::Montgomery, EcmMulMethod::Prac, "Montgomery");
+    std::cout << (ok ? "ecmTest: OK\n" : "ecmTest: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Standalone test of factor() on random 1-limb numbers, batch trial division, factorBatch and SIQS, returns nonzero on failure.
+// Build from the repository root, e.g.: g++ -std=c++20 -O2 -Isrc tests/factorTest.cpp -lgmp
+
+#include "Factorization/factor.h"
+#include "Factorization/BatchTrialDivision.h"
+
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// every factor must be prime and their product must be n
+bool checkFactorization(uint64_t n) {
+    auto factors = factor(BigInt{ n });
+    unsigned __int128 product = 1;
+    bool ok = true;
+    for (const auto& f : factors) {
+        uint64_t value = std::stoull(f.toString());
+        product *= value;
+        if (!isPrime64(value) || product > n) {
+            ok = false;
+            break;
+        }
+    }
+    if (!ok || product != n) {
+        std::cout << "FAIL: factor(" << n << ") =";
+        for (const auto& f : factors) std::cout << ' ' << f;
+        std::cout << '\n';
+        return false;
+    }
+    return true;
+}
+
+// batch trial division must find the same factors as dividing by every prime up to bound
+bool checkBatchTrialDivision(const std::vector<BigIntGmp>& numbers, uint64_t bound) {
+    auto results = batchTrialDivision(numbers, bound);
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+        BigIntGmp cofactor = numbers[i];
+        std::vector<uint64_t> expected;
+        for (auto p : PrimeSieve(2, bound)) {
+            while (mpz_divisible_ui_p(cofactor.data, p)) {
+                mpz_divexact_ui(cofactor.data, cofactor.data, p);
+                expected.push_back(p);
+            }
+        }
+        if (results[i].factors != expected || mpz_cmp(results[i].cofactor.data, cofactor.data) != 0) {
+            std::cout << "FAIL: batchTrialDivision(" << numbers[i] << ", " << bound << ")\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testBatchTrialDivision(std::mt19937_64& rng) {
+    const std::vector<uint64_t> smallPrimes = { 2, 3, 5, 7, 11, 13, 65521, 1009, 15485863, 15485867 };
+    std::vector<BigIntGmp> numbers = { BigIntGmp{ 1 }, BigIntGmp{ 2 }, BigIntGmp{ 65521 }, BigIntGmp{ 15485867 } };
+    for (int i = 0; i < 200; ++i) {
+        BigIntGmp n{ rng() | 1 };
+        for (int k = i % 4; k > 0; --k) {
+            mpz_mul_ui(n.data, n.data, rng());
+        }
+        for (int k = i % 7; k > 0; --k) {
+            mpz_mul_ui(n.data, n.data, smallPrimes[rng() % smallPrimes.size()]);
+        }
+        numbers.push_back(n);
+    }
+    bool ok = checkBatchTrialDivision(numbers, 1000) && checkBatchTrialDivision(numbers, 65536);
+    ok = ok && checkBatchTrialDivision(std::vector<BigIntGmp>(numbers.begin(), numbers.begin() + 20), 16'000'000);
+    ok = ok && checkBatchTrialDivision(numbers, 1);
+    bool zeroRejected = false;
+    try {
+        batchTrialDivision(std::vector<BigIntGmp>{ BigIntGmp{ 0 } }, 1000);
+    } catch (const std::invalid_argument&) {
+        zeroRejected = true;
+    }
+    if (!zeroRejected) {
+        std::cout << "FAIL: batchTrialDivision accepted zero\n";
+    }
+    return ok && zeroRejected;
+}
+
+// factorBatch must return the same factorizations as factor
+bool testFactorBatch(std::mt19937_64& rng) {
+    std::vector<BigInt> numbers = { BigInt{ 1 }, BigInt{ 2 }, BigInt{ 358885161693951 }, BigInt{ std::string("1298074214651415781470873042551159") } };
+    for (int i = 0; i < 50; ++i) {
+        numbers.emplace_back(rng() >> (i % 40));
+    }
+    auto results = factorBatch(numbers);
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+        BigIntGmp product{ 1 };
+        bool ok = !results[i].factors.empty();
+        for (const auto& f : results[i].factors) {
+            BigIntGmp value{ f.toString() };
+            ok &= mpz_cmp_ui(value.data, 1) == 0 ? numbers[i].isOne() : mpz_probab_prime_p(value.data, 30) != 0;
+            mpz_mul(product.data, product.data, value.data);
+        }
+        if (!ok || toString(product) != numbers[i].toString()) {
+            std::cout << "FAIL: factorBatch(" << numbers[i] << ")\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// product of the first primes after a * 10^21 and b * 10^21 (balanced semiprime of 43-44 digits)
+BigIntGmp balancedSemiprime(unsigned long a, unsigned long b) {
+    BigIntGmp p, q, n;
+    mpz_ui_pow_ui(p.data, 10, 21);
+    mpz_mul_ui(q.data, p.data, b);
+    mpz_mul_ui(p.data, p.data, a);
+    mpz_nextprime(p.data, p.data);
+    mpz_nextprime(q.data, q.data);
+    mpz_mul(n.data, p.data, q.data);
+    return n;
+}
+
+// SIQS must split balanced semiprimes directly and through factor, which uses it from SiqsMinBits
+bool testSiqs() {
+    auto n = balancedSemiprime(1, 2);
+    SiqsParams params;
+    auto siqsFactor = siqs(params, n);
+    if (mpz_cmp_ui(siqsFactor.data, 1) <= 0 || mpz_cmp(siqsFactor.data, n.data) >= 0 || !mpz_divisible_p(n.data, siqsFactor.data)) {
+        std::cout << "FAIL: siqs(" << n << ") = " << siqsFactor << '\n';
+        return false;
+    }
+    n = balancedSemiprime(3, 7);
+    auto factors = factor(BigInt{ toString(n) });
+    BigIntGmp product{ 1 };
+    bool ok = factors.size() == 2;
+    for (const auto& f : factors) {
+        BigIntGmp value{ f.toString() };
+        ok &= mpz_probab_prime_p(value.data, 30) != 0;
+        mpz_mul(product.data, product.data, value.data);
+    }
+    if (!ok || mpz_cmp(product.data, n.data) != 0) {
+        std::cout << "FAIL: factor(" << n << ") =";
+        for (const auto& f : factors) std::cout << ' ' << f;
+        std::cout << '\n';
+        return false;
+    }
+    return true;
+}
+
+}
+
+int main() {
+    bool ok = checkFactorization(358885161693951);
+    std::mt19937_64 rng(12345);
+    for (int i = 0; i < 3000 && ok; ++i) {
+        int bits = 2 + i % 63;
+        uint64_t n = (rng() >> (64 - bits)) | (1ull << (bits - 1));
+        ok &= checkFactorization(n);
+    }
+    ok = ok && testBatchTrialDivision(rng);
+    ok = ok && testFactorBatch(rng);
+    ok = ok && testSiqs();
+    std::cout << (ok ? "factorTest: OK\n" : "factorTest: FAILED\n");
+    return ok ? 0 : 1;
+}
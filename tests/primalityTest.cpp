@@ -0,0 +1,89 @@
+// Standalone test of batchIsProbablyPrime against isProbablyPrime, returns nonzero on failure.
+// Build from the repository root, e.g.: g++ -std=c++20 -O2 -Isrc tests/primalityTest.cpp -lgmp
+
+#include "PrimalityTesting/isProbablyPrime.h"
+#include "PrimalityTesting/batchPrimality.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+BigIntGmp randomNumber(std::mt19937_64& rng, int bits) {
+    BigIntGmp n{ 1 };
+    for (int i = 0; i < bits; i += 64) {
+        mpz_mul_2exp(n.data, n.data, 64);
+        mpz_add_ui(n.data, n.data, rng());
+    }
+    mpz_fdiv_r_2exp(n.data, n.data, bits - 1);
+    mpz_setbit(n.data, bits - 1);
+    return n;
+}
+
+BigIntGmp randomPrime(std::mt19937_64& rng, int bits) {
+    auto n = randomNumber(rng, bits);
+    mpz_nextprime(n.data, n.data);
+    return n;
+}
+
+// 1 to 6 limbs: primes, semiprimes, random odd and even numbers and strong pseudoprimes to base 2
+std::vector<BigInt> testNumbers(std::mt19937_64& rng) {
+    std::vector<BigIntGmp> numbers;
+    for (int bits : { 40, 64, 100, 128, 150, 192, 250, 256, 300, 380 }) {
+        for (int i = 0; i < 12; ++i) {
+            numbers.push_back(randomPrime(rng, bits));
+            BigIntGmp semiprime;
+            mpz_mul(semiprime.data, randomPrime(rng, bits / 2).data, randomPrime(rng, bits - bits / 2).data);
+            numbers.push_back(semiprime);
+            auto odd = randomNumber(rng, bits);
+            mpz_setbit(odd.data, 0);
+            numbers.push_back(odd);
+            numbers.push_back(randomNumber(rng, bits));
+        }
+    }
+    // composite Mersenne numbers with prime exponents and Fermat numbers from F5 are strong pseudoprimes to base 2
+    for (int p : { 67, 101, 103, 109, 131, 137, 139, 149, 163, 173, 179, 181, 191, 193, 197, 199, 211, 223, 227, 229, 233, 239, 241, 251 }) {
+        BigIntGmp mersenne;
+        mpz_ui_pow_ui(mersenne.data, 2, p);
+        mpz_sub_ui(mersenne.data, mersenne.data, 1);
+        numbers.push_back(mersenne);
+    }
+    for (int k : { 5, 6, 7, 8 }) {
+        BigIntGmp fermat;
+        mpz_ui_pow_ui(fermat.data, 2, 1ul << k);
+        mpz_add_ui(fermat.data, fermat.data, 1);
+        numbers.push_back(fermat);
+    }
+    // prime Mersenne numbers
+    for (int p : { 61, 89, 107, 127 }) {
+        BigIntGmp mersenne;
+        mpz_ui_pow_ui(mersenne.data, 2, p);
+        mpz_sub_ui(mersenne.data, mersenne.data, 1);
+        numbers.push_back(mersenne);
+    }
+    std::shuffle(numbers.begin(), numbers.end(), rng);
+    std::vector<BigInt> result;
+    for (auto& n : numbers) {
+        result.emplace_back(toString(n));
+    }
+    return result;
+}
+
+}
+
+int main() {
+    std::mt19937_64 rng(12345);
+    auto numbers = testNumbers(rng);
+    auto results = batchIsProbablyPrime(numbers);
+    bool ok = true;
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+        if (results[i] != isProbablyPrime(numbers[i])) {
+            std::cout << "FAIL: batchIsProbablyPrime(" << numbers[i] << ") = " << results[i] << '\n';
+            ok = false;
+        }
+    }
+    std::cout << (ok ? "primalityTest: OK\n" : "primalityTest: FAILED\n");
+    return ok ? 0 : 1;
+}